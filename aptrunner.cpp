@@ -0,0 +1,224 @@
+/**********************************************************************
+ *  aptrunner.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "aptrunner.h"
+
+#include <QFile>
+
+#include <QDebug>
+
+AptRunner::AptRunner(QObject *parent) :
+    QObject(parent)
+{
+    cmd = new Cmd(this);
+    log_file = "/var/log/mxpm-apt.log";
+    phase = None;
+    for (int i = 0; i < PhaseCount; ++i) {
+        phase_times[i] = 0;
+    }
+    connect(cmd, &Cmd::outputAvailable, this, &AptRunner::onOutput);
+}
+
+// Run apt-get with the status stream on fd 3 (sent to our stdout), regular apt/dpkg output goes to the log file
+// There is no terminal for the dpkg conffile prompt: local changes are kept, see keptConffiles()
+int AptRunner::run(const QString &args)
+{
+    phase = None;
+    buffer.clear();
+    errors.clear();
+    conffiles.clear();
+    for (int i = 0; i < PhaseCount; ++i) {
+        phase_times[i] = 0;
+    }
+
+    QString apt_cmd = "DEBIAN_FRONTEND=noninteractive LC_ALL=en_US.UTF-8 apt-get -y -q -o APT::Status-Fd=3 "\
+                      "-o Dpkg::Use-Pty=0 -o Dpkg::Options::=--force-confdef -o Dpkg::Options::=--force-confold " + args;
+    int ret = cmd->run(apt_cmd + " 3>&1 1>" + log_file + " 2>&1");
+
+    if (!buffer.isEmpty()) {
+        processLine(buffer);
+        buffer.clear();
+    }
+    startPhase(None); // close the last phase
+    findKeptConffiles();
+    qDebug() << "apt-get" << args << "exit code:" << ret;
+    qDebug() << "phase times (ms) download:" << phase_times[Download] << "unpack:" << phase_times[Unpack]
+             << "configure:" << phase_times[Configure] << "remove:" << phase_times[Remove];
+    return ret;
+}
+
+// Time spent in a phase during the last run, in milliseconds
+qint64 AptRunner::phaseTime(Phase phase)
+{
+    return phase_times[phase];
+}
+
+// Return the regular apt-get output of the last run
+QString AptRunner::getLog()
+{
+    QFile file(log_file);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        qDebug() << "Could not open: " << file.fileName();
+        return QString();
+    }
+    return QString(file.readAll()).trimmed();
+}
+
+// Return the errors reported by dpkg during the last run
+QStringList AptRunner::getErrors()
+{
+    return errors;
+}
+
+// Return the config files of the last run whose local changes were kept (--force-confold), the version
+// shipped by the package was saved as <file>.dpkg-dist
+QStringList AptRunner::keptConffiles()
+{
+    return conffiles;
+}
+
+// Fill actions with what apt-get would do, without changing the system. Return the apt-get exit code, on
+// failure (lock held, unmet dependencies...) the output is in getErrors()
+int AptRunner::simulate(const QString &args, QStringList *actions)
+{
+    errors.clear();
+    actions->clear();
+    int ret = cmd->run("LC_ALL=en_US.UTF-8 apt-get -s -q " + args + " 2>&1");
+    QString out = cmd->getOutput();
+    if (ret != 0) {
+        qDebug() << "apt-get -s" << args << "exit code:" << ret;
+        errors = out.split("\n");
+        return ret;
+    }
+    foreach (const QString &line, out.split("\n")) {
+        if (line.startsWith("Inst ") || line.startsWith("Remv ")) {
+            *actions << line.section(" ", 0, 1);
+        }
+    }
+    return ret;
+}
+
+// Terminate apt-get
+bool AptRunner::terminate()
+{
+    return cmd->terminate();
+}
+
+// Split the output in lines, keep the incomplete line for the next read
+void AptRunner::onOutput(const QString &output)
+{
+    buffer += output;
+    int pos;
+    while ((pos = buffer.indexOf("\n")) != -1) {
+        processLine(buffer.left(pos).trimmed());
+        buffer.remove(0, pos + 1);
+    }
+}
+
+// Process one "dlstatus:", "pmstatus:" or "pmerror:" line
+void AptRunner::processLine(const QString &line)
+{
+    QStringList fields = line.split(":");
+    QString type = fields.at(0);
+    if (type != "dlstatus" && type != "pmstatus" && type != "pmerror") {
+        return;
+    }
+
+    // package names might contain ':' (multiarch), percent is the first numeric field after the first one
+    bool ok = false;
+    double percent = 0;
+    int i = 2;
+    for (; i < fields.size(); ++i) {
+        percent = fields.at(i).toDouble(&ok);
+        if (ok) {
+            break;
+        }
+    }
+    if (!ok) {
+        return;
+    }
+    QString message = QStringList(fields.mid(i + 1)).join(":");
+
+    if (type == "pmerror") {
+        errors << QStringList(fields.mid(1, i - 1)).join(":") + ": " + message;
+        return;
+    }
+    if (type == "dlstatus") {
+        startPhase(Download);
+    } else {
+        Phase new_phase = phaseFor(message);
+        if (new_phase != None) {
+            startPhase(new_phase);
+        }
+    }
+    emit progress(qRound(percent), message);
+}
+
+// Find the phase from the pmstatus message
+AptRunner::Phase AptRunner::phaseFor(const QString &message)
+{
+    if (message.startsWith("Running dpkg")) {
+        return None;
+    }
+    if (message.startsWith("Preparing to configure") || message.startsWith("Configuring") ||
+            message.startsWith("Installed") || message.startsWith("Running post-installation trigger")) {
+        return Configure;
+    }
+    if (message.startsWith("Preparing for removal") || message.startsWith("Removing") || message.startsWith("Removed") ||
+            message.startsWith("Preparing to completely remove") || message.startsWith("Completely remov")) {
+        return Remove;
+    }
+    return Unpack;
+}
+
+// dpkg prints "Configuration file '<file>'" followed by "==> Keeping old config file as default." when the
+// local version is kept
+void AptRunner::findKeptConffiles()
+{
+    QString file;
+    foreach (const QString &line, getLog().split("\n")) {
+        if (line.startsWith("Configuration file '")) {
+            file = line.section("'", 1, 1);
+        } else if (!file.isEmpty() && line.contains("Keeping old config file as default")) {
+            conffiles << file;
+            file.clear();
+        }
+    }
+}
+
+// Record the time spent in the current phase and start timing the new one
+void AptRunner::startPhase(Phase new_phase)
+{
+    if (new_phase == phase) {
+        return;
+    }
+    if (phase != None) {
+        phase_times[phase] += phase_timer.elapsed();
+    }
+    phase = new_phase;
+    phase_timer.start();
+    if (phase != None) {
+        emit phaseChanged(phase);
+    }
+}
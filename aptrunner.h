@@ -0,0 +1,76 @@
+/**********************************************************************
+ *  aptrunner.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef APTRUNNER_H
+#define APTRUNNER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <cmd.h>
+
+// Runs apt-get without a terminal and reports progress parsed from APT::Status-Fd
+class AptRunner : public QObject
+{
+    Q_OBJECT
+public:
+    enum Phase { None, Download, Unpack, Configure, Remove, PhaseCount };
+
+    explicit AptRunner(QObject *parent = 0);
+
+    int run(const QString &args); // runs "apt-get -y <args>", returns apt-get exit code
+    qint64 phaseTime(Phase phase); // time spent in each phase in ms
+    QString getLog();
+    QStringList getErrors();
+    QStringList keptConffiles(); // config files that kept local changes, the packaged version is next to them
+    int simulate(const QString &args, QStringList *actions); // returns apt-get -s exit code, errors in getErrors()
+
+signals:
+    void progress(int percent, const QString &message);
+    void phaseChanged(AptRunner::Phase phase);
+
+public slots:
+    bool terminate();
+
+private slots:
+    void onOutput(const QString &output);
+
+private:
+    Cmd *cmd;
+    Phase phase;
+    QElapsedTimer phase_timer;
+    qint64 phase_times[PhaseCount];
+    QString buffer; // holds incomplete status line between reads
+    QString log_file;
+    QStringList errors;
+    QStringList conffiles;
+
+    void findKeptConffiles();
+    Phase phaseFor(const QString &message);
+    void processLine(const QString &line);
+    void startPhase(Phase new_phase);
+};
+
+#endif // APTRUNNER_H
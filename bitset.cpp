@@ -0,0 +1,139 @@
+/**********************************************************************
+ *  bitset.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "bitset.h"
+
+Bitset::Bitset() :
+    bits(0)
+{
+}
+
+Bitset::Bitset(int size, bool value) :
+    bits(size),
+    words((size + 63) / 64, value ? ~Q_UINT64_C(0) : 0)
+{
+    clearPadding();
+}
+
+int Bitset::size() const
+{
+    return bits;
+}
+
+int Bitset::count() const
+{
+    int total = 0;
+    for (int i = 0; i < words.size(); ++i) {
+        total += __builtin_popcountll(words.at(i));
+    }
+    return total;
+}
+
+bool Bitset::testBit(int index) const
+{
+    return words.at(index / 64) & (Q_UINT64_C(1) << (index % 64));
+}
+
+void Bitset::setBit(int index, bool value)
+{
+    if (value) {
+        words[index / 64] |= Q_UINT64_C(1) << (index % 64);
+    } else {
+        words[index / 64] &= ~(Q_UINT64_C(1) << (index % 64));
+    }
+}
+
+// Skip empty words and jump from one set bit to the next
+QVector<int> Bitset::indexes() const
+{
+    QVector<int> result;
+    result.reserve(count());
+    for (int i = 0; i < words.size(); ++i) {
+        quint64 word = words.at(i);
+        while (word) {
+            result << i * 64 + __builtin_ctzll(word);
+            word &= word - 1; // clear the lowest set bit
+        }
+    }
+    return result;
+}
+
+// Bitsets of different sizes are combined over the shorter one, the rest is cleared
+Bitset &Bitset::operator&=(const Bitset &other)
+{
+    int common = qMin(words.size(), other.words.size());
+    quint64 *data = words.data();
+    const quint64 *other_data = other.words.constData();
+    for (int i = 0; i < common; ++i) {
+        data[i] &= other_data[i];
+    }
+    for (int i = common; i < words.size(); ++i) {
+        data[i] = 0;
+    }
+    return *this;
+}
+
+Bitset &Bitset::operator|=(const Bitset &other)
+{
+    int common = qMin(words.size(), other.words.size());
+    quint64 *data = words.data();
+    const quint64 *other_data = other.words.constData();
+    for (int i = 0; i < common; ++i) {
+        data[i] |= other_data[i];
+    }
+    clearPadding();
+    return *this;
+}
+
+Bitset Bitset::operator&(const Bitset &other) const
+{
+    Bitset result(*this);
+    result &= other;
+    return result;
+}
+
+Bitset Bitset::operator|(const Bitset &other) const
+{
+    Bitset result(*this);
+    result |= other;
+    return result;
+}
+
+Bitset Bitset::operator~() const
+{
+    Bitset result(*this);
+    quint64 *data = result.words.data();
+    for (int i = 0; i < result.words.size(); ++i) {
+        data[i] = ~data[i];
+    }
+    result.clearPadding();
+    return result;
+}
+
+void Bitset::clearPadding()
+{
+    if (bits % 64 != 0) {
+        words.last() &= (Q_UINT64_C(1) << (bits % 64)) - 1;
+    }
+}
@@ -0,0 +1,56 @@
+/**********************************************************************
+ *  bitset.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <QVector>
+
+// Fixed size set of bits kept in 64-bit words, used to combine per-package flags a word at a time
+class Bitset
+{
+public:
+    Bitset();
+    explicit Bitset(int size, bool value = false);
+
+    int size() const;
+    int count() const; // bits that are set
+    bool testBit(int index) const;
+    void setBit(int index, bool value = true);
+    QVector<int> indexes() const; // positions of the bits that are set, in order
+
+    Bitset &operator&=(const Bitset &other);
+    Bitset &operator|=(const Bitset &other);
+    Bitset operator&(const Bitset &other) const;
+    Bitset operator|(const Bitset &other) const;
+    Bitset operator~() const;
+
+private:
+    int bits;
+    QVector<quint64> words;
+
+    void clearPadding(); // keep the unused bits of the last word at 0
+};
+
+#endif // BITSET_H
@@ -42,8 +42,9 @@ Cmd::~Cmd()
 {
 }
 
-// this function is running the command, takes cmd_str and optional estimated completion time
-int Cmd::run(const QString &cmd_str, int est_duration)
+// this function is running the command, takes cmd_str and optional estimated completion time,
+// the watchdog terminates the command if it runs too long or stops printing output
+int Cmd::run(const QString &cmd_str, int est_duration, Watchdog *watchdog)
 {
     this->est_duration = est_duration;
     if (proc->state() != QProcess::NotRunning) {
@@ -64,7 +65,17 @@ int Cmd::run(const QString &cmd_str, int est_duration)
     QEventLoop loop;
     connect(proc, static_cast<void (QProcess::*)(int)>(&QProcess::finished), &loop, &QEventLoop::quit);
     connect(proc, &QProcess::readyReadStandardOutput, this, &Cmd::onStdoutAvailable);
+    if (watchdog) {
+        connect(proc, &QProcess::readyReadStandardOutput, watchdog, &Watchdog::kick);
+        connect(watchdog, &Watchdog::expired, this, &Cmd::terminate);
+        watchdog->start();
+    }
     loop.exec();
+    if (watchdog) {
+        watchdog->stop();
+        disconnect(proc, &QProcess::readyReadStandardOutput, watchdog, &Watchdog::kick);
+        disconnect(watchdog, &Watchdog::expired, this, &Cmd::terminate);
+    }
 
     qDebug() << "running cmd:" << proc->arguments().at(1);
 
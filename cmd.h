@@ -29,6 +29,8 @@
 #include <QProcess>
 #include <QTimer>
 
+#include <watchdog.h>
+
 class Cmd : public QObject
 {
     Q_OBJECT
@@ -37,7 +39,7 @@ public:
     ~Cmd();
 
     bool isRunning();
-    int run(const QString &cmd_str, int = 0); // with option estimated time of completion
+    int run(const QString &cmd_str, int = 0, Watchdog *watchdog = 0); // with option estimated time of completion and time limits
     QString getOutput();
     QString getOutput(const QString &cmd_str);
 
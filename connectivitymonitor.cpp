@@ -0,0 +1,158 @@
+/**********************************************************************
+ *  connectivitymonitor.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "connectivitymonitor.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <QDebug>
+
+ConnectivityMonitor::ConnectivityMonitor(const QStringList &hosts, QObject *parent) :
+    QObject(parent),
+    known(false),
+    online(false),
+    failed(0),
+    ttl(30000),
+    notifier(0),
+    hosts(hosts)
+{
+    manager = new QNetworkAccessManager(this);
+    time_limit = new Watchdog("probe", 3, 0, this);
+    connect(time_limit, &Watchdog::expired, this, &ConnectivityMonitor::onTimeout);
+    settle.setSingleShot(true);
+    settle.setInterval(1000);
+    connect(&settle, &QTimer::timeout, this, &ConnectivityMonitor::probe);
+
+    netlink_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR | RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+    if (netlink_fd == -1 || bind(netlink_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == -1) {
+        qDebug() << "Could not listen for network changes:" << strerror(errno);
+        if (netlink_fd != -1) {
+            close(netlink_fd);
+            netlink_fd = -1;
+        }
+    } else {
+        notifier = new QSocketNotifier(netlink_fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &ConnectivityMonitor::onNetlink);
+    }
+}
+
+ConnectivityMonitor::~ConnectivityMonitor()
+{
+    delete notifier;
+    if (netlink_fd != -1) {
+        close(netlink_fd);
+    }
+}
+
+// Return the cached state while it's recent, otherwise wait for the probe.
+// The wait is short: the first host that answers ends it and probes give up after a few seconds
+bool ConnectivityMonitor::isOnline()
+{
+    if (known && age.elapsed() < ttl) {
+        return online;
+    }
+    probe();
+    if (!replies.isEmpty()) {
+        loop.exec();
+    }
+    return online;
+}
+
+// Ask all the hosts at the same time for their headers, one answer is enough. Going through
+// QNetworkAccessManager the probe uses the same proxy as the downloads
+void ConnectivityMonitor::probe()
+{
+    if (!replies.isEmpty()) { // already probing
+        return;
+    }
+    if (hosts.isEmpty()) {
+        finish(false);
+        return;
+    }
+    failed = 0;
+    time_limit->start();
+    foreach (const QString &host, hosts) {
+        QNetworkReply *reply = manager->head(QNetworkRequest(QUrl("http://" + host + "/")));
+        connect(reply, &QNetworkReply::finished, this, &ConnectivityMonitor::onReplyFinished);
+        replies << reply;
+    }
+}
+
+// Any HTTP answer means the host was reached, except the gateway errors a proxy sends when it couldn't reach it.
+// Offline only when all the hosts failed
+void ConnectivityMonitor::onReplyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply || !replies.contains(reply)) {
+        return;
+    }
+    int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (status != 0 && status != 502 && status != 504) {
+        finish(true);
+    } else if (++failed == replies.size()) {
+        finish(false);
+    }
+}
+
+// Drain the netlink messages, the content doesn't matter, any change invalidates the cached state
+void ConnectivityMonitor::onNetlink()
+{
+    char buffer[8192];
+    while (recv(netlink_fd, buffer, sizeof(buffer), 0) > 0) {
+    }
+    known = false;
+    settle.start();
+}
+
+void ConnectivityMonitor::onTimeout()
+{
+    finish(false);
+}
+
+void ConnectivityMonitor::finish(bool result)
+{
+    time_limit->stop();
+    foreach (QNetworkReply *reply, replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+    replies.clear();
+    if (!known || result != online) {
+        qDebug() << "online:" << result;
+    }
+    online = result;
+    known = true;
+    age.start();
+    loop.quit();
+}
@@ -0,0 +1,76 @@
+/**********************************************************************
+ *  connectivitymonitor.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef CONNECTIVITYMONITOR_H
+#define CONNECTIVITYMONITOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTimer>
+
+#include <watchdog.h>
+
+// Checks if the repo hosts can be reached, through the application proxy if one is set. The result is
+// cached for a short time and invalidated when netlink reports link, address or route changes
+class ConnectivityMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConnectivityMonitor(const QStringList &hosts, QObject *parent = 0);
+    ~ConnectivityMonitor();
+
+    bool isOnline(); // cached state if recent, otherwise waits for a probe
+
+public slots:
+    void probe(); // start probing in the background
+
+private slots:
+    void onNetlink();
+    void onReplyFinished();
+    void onTimeout();
+
+private:
+    bool known;
+    bool online;
+    int failed; // hosts that couldn't be reached in the current probe
+    int netlink_fd;
+    int ttl; // ms
+    QElapsedTimer age;
+    QEventLoop loop;
+    QList<QNetworkReply *> replies;
+    QNetworkAccessManager *manager;
+    QSocketNotifier *notifier;
+    QStringList hosts;
+    QTimer settle; // netlink events come in bursts, probe once they settle
+    Watchdog *time_limit;
+
+    void finish(bool result);
+};
+
+#endif // CONNECTIVITYMONITOR_H
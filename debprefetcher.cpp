@@ -0,0 +1,259 @@
+/**********************************************************************
+ *  debprefetcher.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "debprefetcher.h"
+
+#include <QEventLoop>
+#include <QRegExp>
+
+#include <QDebug>
+
+DebPrefetcher::DebPrefetcher(FetchScheduler *scheduler, QObject *parent) :
+    QObject(parent),
+    scheduler(scheduler)
+{
+    manager = new QNetworkAccessManager(this);
+    proc = new QProcess(this);
+    archive_dir = "/var/cache/apt/archives";
+    done_bytes = 0;
+    total_bytes = 0;
+    time_limit = new Watchdog("prefetch", 600, 60, this);
+    connect(proc, static_cast<void (QProcess::*)(int)>(&QProcess::finished), this, &DebPrefetcher::onUrisAvailable);
+    connect(time_limit, &Watchdog::expired, this, &DebPrefetcher::cancel);
+    connect(scheduler, &FetchScheduler::released, this, &DebPrefetcher::startDownloads, Qt::QueuedConnection);
+}
+
+bool DebPrefetcher::isRunning()
+{
+    return proc->state() != QProcess::NotRunning || !items.isEmpty() || !pending.isEmpty();
+}
+
+// Ask apt-get which .debs the install needs, then download them. Restarts if a different set is requested
+void DebPrefetcher::prefetch(const QString &args)
+{
+    if (args == requested_args && isRunning()) {
+        return;
+    }
+    cancel();
+    requested_args = args;
+    if (args.trimmed().isEmpty()) {
+        return;
+    }
+    // --print-uris doesn't lock and lists only the files that are not already in the archive cache
+    proc->start("/bin/bash", QStringList() << "-c" << "LC_ALL=en_US.UTF-8 apt-get install --reinstall -qq --print-uris "\
+                "-o Debug::NoLocking=1 " + args + " 2>/dev/null");
+}
+
+// Block (keeping the event loop running) until the current prefetch is done or cancelled
+void DebPrefetcher::waitForFinished()
+{
+    if (!isRunning()) {
+        return;
+    }
+    QEventLoop loop;
+    connect(this, &DebPrefetcher::finished, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+// Stop all downloads, files that were completed stay in the cache
+void DebPrefetcher::cancel()
+{
+    bool running = isRunning();
+    time_limit->stop();
+    if (proc->state() != QProcess::NotRunning) {
+        proc->blockSignals(true);
+        proc->kill();
+        proc->waitForFinished(1000);
+        proc->blockSignals(false);
+    }
+    pending.clear();
+    foreach (QNetworkReply *reply, items.keys()) {
+        reply->blockSignals(true);
+        reply->abort();
+        scheduler->release(items.value(reply).url);
+        QFile *file = files.take(reply);
+        file->remove();
+        delete file;
+        reply->deleteLater();
+    }
+    items.clear();
+    received_bytes.clear();
+    requested_args.clear();
+    if (running) {
+        qDebug() << "prefetch cancelled";
+        emit finished();
+    }
+}
+
+void DebPrefetcher::onDownloadProgress(qint64 received, qint64 /*total*/)
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply) {
+        received_bytes[reply] = received;
+    }
+    qint64 sum = done_bytes;
+    foreach (qint64 bytes, received_bytes) {
+        sum += bytes;
+    }
+    emit progress(sum, total_bytes);
+}
+
+// Write the downloaded data to the partial file
+void DebPrefetcher::onReadyRead()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (reply && files.contains(reply)) {
+        files.value(reply)->write(reply->readAll());
+    }
+}
+
+// Verify the downloaded file and move it into the archive cache
+void DebPrefetcher::onReplyFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply || !items.contains(reply)) {
+        return;
+    }
+    Item item = items.take(reply);
+    QFile *file = files.take(reply);
+    received_bytes.remove(reply);
+    scheduler->release(item.url);
+    file->write(reply->readAll());
+    file->close();
+
+    if (reply->error() != QNetworkReply::NoError) {
+        qDebug() << "prefetch of" << item.url.toString() << "failed:" << reply->errorString();
+        file->remove();
+    } else if (!checkFile(file->fileName(), item)) {
+        qDebug() << "prefetch of" << item.file_name << "failed verification";
+        file->remove();
+    } else {
+        QString target = archive_dir + "/" + item.file_name;
+        if (QFile::exists(target) || !file->rename(target)) { // apt got it already
+            file->remove();
+        }
+        done_bytes += item.size;
+    }
+    delete file;
+    reply->deleteLater();
+
+    startDownloads();
+    if (items.isEmpty() && pending.isEmpty()) {
+        finish();
+    }
+}
+
+// Parse "'URL' file_name size hash" lines from apt-get --print-uris and start downloading
+void DebPrefetcher::onUrisAvailable(int exit_code)
+{
+    QString out = proc->readAllStandardOutput();
+    if (exit_code != 0) {
+        qDebug() << "could not get the list of packages to prefetch";
+        finish();
+        return;
+    }
+    done_bytes = 0;
+    total_bytes = 0;
+    QRegExp re("^'([^']+)'\\s+(\\S+)\\s+(\\d+)\\s*(\\S*)");
+    foreach (const QString &line, out.split("\n", QString::SkipEmptyParts)) {
+        if (re.indexIn(line.trimmed()) == -1 || !re.cap(2).endsWith(".deb")) {
+            continue;
+        }
+        Item item;
+        item.url = QUrl(re.cap(1));
+        item.file_name = re.cap(2);
+        item.size = re.cap(3).toLongLong();
+        item.hash = re.cap(4);
+        if (item.hash.isEmpty() || QFile::exists(archive_dir + "/" + item.file_name)) {
+            continue; // without a hash the file can't be verified, leave it to apt-get
+        }
+        pending << item;
+        total_bytes += item.size;
+    }
+    qDebug() << "prefetching" << pending.size() << "packages," << total_bytes << "bytes";
+    time_limit->start();
+    startDownloads();
+    if (items.isEmpty() && pending.isEmpty()) {
+        finish();
+    }
+}
+
+// Check size and hash of a downloaded file
+bool DebPrefetcher::checkFile(const QString &file_name, const Item &item)
+{
+    QFile file(file_name);
+    if (file.size() != item.size || !file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    QString type = item.hash.section(":", 0, 0);
+    QString value = item.hash.section(":", 1);
+    QCryptographicHash::Algorithm algorithm;
+    if (type == "SHA512") {
+        algorithm = QCryptographicHash::Sha512;
+    } else if (type == "SHA256") {
+        algorithm = QCryptographicHash::Sha256;
+    } else if (type == "SHA1") {
+        algorithm = QCryptographicHash::Sha1;
+    } else if (type == "MD5Sum") {
+        algorithm = QCryptographicHash::Md5;
+    } else {
+        qDebug() << "no usable hash for" << item.file_name << item.hash;
+        return false; // a file that can't be verified never goes into the archive cache
+    }
+    QCryptographicHash hash(algorithm);
+    hash.addData(&file);
+    return hash.result().toHex() == value.toLatin1().toLower();
+}
+
+void DebPrefetcher::finish()
+{
+    time_limit->stop();
+    requested_args.clear();
+    emit finished();
+}
+
+// Start the pending downloads the scheduler has room for
+void DebPrefetcher::startDownloads()
+{
+    for (int i = 0; i < pending.size(); ++i) {
+        if (!scheduler->acquire(pending.at(i).url)) {
+            continue;
+        }
+        Item item = pending.takeAt(i--);
+        QFile *file = new QFile(archive_dir + "/partial/" + item.file_name + ".mxpm");
+        if (!file->open(QFile::WriteOnly | QFile::Truncate)) {
+            qDebug() << "Could not open file: " << file->fileName();
+            scheduler->release(item.url);
+            delete file;
+            continue;
+        }
+        QNetworkReply *reply = manager->get(QNetworkRequest(item.url));
+        items.insert(reply, item);
+        files.insert(reply, file);
+        connect(reply, &QNetworkReply::readyRead, this, &DebPrefetcher::onReadyRead);
+        connect(reply, &QNetworkReply::readyRead, time_limit, &Watchdog::kick);
+        connect(reply, &QNetworkReply::downloadProgress, this, &DebPrefetcher::onDownloadProgress);
+        connect(reply, &QNetworkReply::finished, this, &DebPrefetcher::onReplyFinished);
+    }
+}
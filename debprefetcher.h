@@ -0,0 +1,92 @@
+/**********************************************************************
+ *  debprefetcher.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef DEBPREFETCHER_H
+#define DEBPREFETCHER_H
+
+#include <QObject>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QProcess>
+#include <QStringList>
+#include <QUrl>
+
+#include <fetchscheduler.h>
+#include <watchdog.h>
+
+// Downloads the .debs needed for an install into apt's archive cache in the background.
+// Gives up when the "prefetch" deadline or stall limits are exceeded, apt-get downloads what is missing
+class DebPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DebPrefetcher(FetchScheduler *scheduler, QObject *parent = 0);
+
+    bool isRunning();
+    void prefetch(const QString &args); // args for "apt-get install", e.g. "pkg1 pkg2/release+"
+    void waitForFinished();
+
+signals:
+    void progress(qint64 received, qint64 total);
+    void finished();
+
+public slots:
+    void cancel();
+
+private slots:
+    void onDownloadProgress(qint64 received, qint64 total);
+    void onReadyRead();
+    void onReplyFinished();
+    void startDownloads();
+    void onUrisAvailable(int exit_code);
+
+private:
+    struct Item {
+        QUrl url;
+        QString file_name;
+        qint64 size;
+        QString hash; // "SHA256:..." as printed by apt-get --print-uris
+    };
+
+    FetchScheduler *scheduler;
+    QNetworkAccessManager *manager;
+    QProcess *proc;
+    Watchdog *time_limit;
+    QList<Item> pending;
+    QHash<QNetworkReply *, Item> items;
+    QHash<QNetworkReply *, QFile *> files;
+    QHash<QNetworkReply *, qint64> received_bytes;
+    QString archive_dir;
+    QString requested_args;
+    qint64 done_bytes;
+    qint64 total_bytes;
+
+    bool checkFile(const QString &file_name, const Item &item);
+    void finish();
+};
+
+#endif // DEBPREFETCHER_H
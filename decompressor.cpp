@@ -0,0 +1,146 @@
+/**********************************************************************
+ *  decompressor.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "decompressor.h"
+
+#include <QDebug>
+
+Decompressor::Decompressor(Format format) :
+    format(format)
+{
+    stream_end = (format == Plain);
+    if (format == Gzip) {
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+        stream.next_in = Z_NULL;
+        stream.avail_in = 0;
+        inflateInit2(&stream, 16 + MAX_WBITS); // 16: expect gzip header
+    } else if (format == Xz) {
+        lzma_stream init = LZMA_STREAM_INIT;
+        xz_stream = init;
+        if (lzma_stream_decoder(&xz_stream, UINT64_MAX, 0) != LZMA_OK) {
+            qDebug() << "Could not initialize the xz decoder";
+        }
+    }
+}
+
+Decompressor::~Decompressor()
+{
+    if (format == Gzip) {
+        inflateEnd(&stream);
+    } else if (format == Xz) {
+        lzma_end(&xz_stream);
+    }
+}
+
+Decompressor::Format Decompressor::formatFor(const QString &file_name)
+{
+    if (file_name.endsWith(".xz")) {
+        return Xz;
+    } else if (file_name.endsWith(".gz")) {
+        return Gzip;
+    }
+    return Plain;
+}
+
+// Decompress a chunk and append the result to out
+bool Decompressor::feed(const QByteArray &data, QByteArray *out)
+{
+    if (format == Gzip) {
+        return feedGzip(data, out);
+    } else if (format == Xz) {
+        return feedXz(data, out);
+    }
+    out->append(data);
+    return true;
+}
+
+bool Decompressor::isFinished()
+{
+    return stream_end;
+}
+
+// Gzip files made of several members are decoded as one stream
+bool Decompressor::feedGzip(const QByteArray &data, QByteArray *out)
+{
+    const int size = 64 * 1024;
+    char buffer[size];
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    stream.avail_in = data.size();
+    while (true) {
+        if (stream_end) {
+            if (stream.avail_in == 0) {
+                break;
+            }
+            if (stream.next_in[0] != 0x1f) { // not another gzip member, ignore trailing padding
+                stream.avail_in = 0;
+                break;
+            }
+            inflateReset(&stream);
+            stream_end = false;
+        }
+        stream.next_out = reinterpret_cast<Bytef *>(buffer);
+        stream.avail_out = size;
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            stream_end = true;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            qDebug() << "inflate error:" << ret << (stream.msg ? stream.msg : "");
+            return false;
+        }
+        out->append(buffer, size - stream.avail_out);
+        if (!stream_end && stream.avail_out != 0) { // all the input was used
+            break;
+        }
+    }
+    return true;
+}
+
+// Data after the end of the xz stream (padding) is ignored
+bool Decompressor::feedXz(const QByteArray &data, QByteArray *out)
+{
+    const int size = 64 * 1024;
+    char buffer[size];
+
+    xz_stream.next_in = reinterpret_cast<const uint8_t *>(data.constData());
+    xz_stream.avail_in = data.size();
+    while (!stream_end) {
+        xz_stream.next_out = reinterpret_cast<uint8_t *>(buffer);
+        xz_stream.avail_out = size;
+        lzma_ret ret = lzma_code(&xz_stream, LZMA_RUN);
+        if (ret == LZMA_STREAM_END) {
+            stream_end = true;
+        } else if (ret != LZMA_OK && ret != LZMA_BUF_ERROR) {
+            qDebug() << "xz decoder error:" << ret;
+            return false;
+        }
+        out->append(buffer, size - xz_stream.avail_out);
+        if (xz_stream.avail_out != 0) { // all the input was used
+            break;
+        }
+    }
+    return true;
+}
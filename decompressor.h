@@ -0,0 +1,60 @@
+/**********************************************************************
+ *  decompressor.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef DECOMPRESSOR_H
+#define DECOMPRESSOR_H
+
+#include <QByteArray>
+#include <QString>
+
+#include <lzma.h>
+#include <zlib.h>
+
+// Incremental gzip/xz decoder, compressed data can be fed in chunks as it arrives
+class Decompressor
+{
+public:
+    enum Format { Plain, Gzip, Xz };
+
+    explicit Decompressor(Format format = Gzip);
+    ~Decompressor();
+
+    static Format formatFor(const QString &file_name); // guess from the extension
+
+    bool feed(const QByteArray &data, QByteArray *out); // appends decompressed data to out, false on error
+    bool isFinished(); // true if the end of the compressed stream was reached
+
+private:
+    Format format;
+    z_stream stream;
+    lzma_stream xz_stream;
+    bool stream_end;
+
+    bool feedGzip(const QByteArray &data, QByteArray *out);
+    bool feedXz(const QByteArray &data, QByteArray *out);
+
+    Q_DISABLE_COPY(Decompressor)
+};
+
+#endif // DECOMPRESSOR_H
@@ -0,0 +1,59 @@
+/**********************************************************************
+ *  fetchscheduler.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "fetchscheduler.h"
+
+#include <QSettings>
+
+// Limits can be set in /etc/mx-package-manager.conf, section [Network]
+FetchScheduler::FetchScheduler(QObject *parent) :
+    QObject(parent),
+    active(0)
+{
+    QSettings config("/etc/mx-package-manager.conf", QSettings::IniFormat);
+    max_connections = qMax(1, config.value("Network/max_connections", 6).toInt());
+    max_per_host = qMax(1, config.value("Network/max_per_host", 2).toInt());
+}
+
+bool FetchScheduler::acquire(const QUrl &url)
+{
+    if (active >= max_connections || per_host.value(url.host()) >= max_per_host) {
+        return false;
+    }
+    ++active;
+    ++per_host[url.host()];
+    return true;
+}
+
+void FetchScheduler::release(const QUrl &url)
+{
+    if (per_host.value(url.host()) == 0) {
+        return;
+    }
+    --active;
+    if (--per_host[url.host()] == 0) {
+        per_host.remove(url.host());
+    }
+    emit released();
+}
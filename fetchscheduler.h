@@ -0,0 +1,54 @@
+/**********************************************************************
+ *  fetchscheduler.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef FETCHSCHEDULER_H
+#define FETCHSCHEDULER_H
+
+#include <QObject>
+#include <QMap>
+#include <QUrl>
+
+// Limits the connections open at the same time, in total and to each host. Shared by the downloaders:
+// each one takes a slot before starting a request, gives it back when the request is done and
+// tries to start its waiting requests when released() is emitted
+class FetchScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FetchScheduler(QObject *parent = 0);
+
+    bool acquire(const QUrl &url); // true if a slot was taken for the host of url
+    void release(const QUrl &url);
+
+signals:
+    void released();
+
+private:
+    int active;
+    int max_connections;
+    int max_per_host;
+    QMap<QString, int> per_host;
+};
+
+#endif // FETCHSCHEDULER_H
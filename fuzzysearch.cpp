@@ -0,0 +1,182 @@
+/**********************************************************************
+ *  fuzzysearch.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "fuzzysearch.h"
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+
+FuzzySearch::FuzzySearch() :
+    count(0)
+{
+    name_offsets << 0;
+    description_offsets << 0;
+}
+
+FuzzySearch::FuzzySearch(const QStringList &names, const QStringList &descriptions) :
+    count(names.size())
+{
+    name_offsets.reserve(count + 1);
+    description_offsets.reserve(count + 1);
+    for (int id = 0; id < count; ++id) {
+        name_offsets << this->names.size();
+        this->names += names.at(id).toLower().toUtf8();
+        this->names += '\0';
+        description_offsets << this->descriptions.size();
+        this->descriptions += descriptions.at(id).toLower().toUtf8();
+        this->descriptions += '\0';
+    }
+    name_offsets << this->names.size();
+    description_offsets << this->descriptions.size();
+}
+
+// Split the allowed rows in one chunk per core, merge the best matches of each chunk
+QVector<int> FuzzySearch::find(const QString &text, const Bitset &allowed, int limit, int *total) const
+{
+    QVector<int> ids;
+    if (total) {
+        *total = 0;
+    }
+    QByteArray needle = text.trimmed().toLower().toUtf8();
+    if (needle.isEmpty() || limit <= 0) {
+        return ids;
+    }
+
+    const int min_chunk = 4096; // smaller chunks cost more to schedule than to score
+    int chunk_size = qMax(min_chunk, count / qMax(1, QThread::idealThreadCount()) + 1);
+    QList<Chunk> chunks;
+    for (int begin = 0; begin < count; begin += chunk_size) {
+        Chunk chunk = {this, &allowed, needle, begin, qMin(count, begin + chunk_size), limit};
+        chunks << chunk;
+    }
+    QList<ChunkResult> results = QtConcurrent::blockingMapped<QList<ChunkResult> >(chunks, &FuzzySearch::scoreChunk);
+
+    QVector<Match> matches;
+    foreach (const ChunkResult &result, results) {
+        matches += result.matches;
+        if (total) {
+            *total += result.total;
+        }
+    }
+    keepBest(&matches, limit);
+    std::sort(matches.begin(), matches.end(), better);
+    ids.reserve(matches.size());
+    foreach (const Match &match, matches) {
+        ids << match.id;
+    }
+    return ids;
+}
+
+qint64 FuzzySearch::memoryUsage() const
+{
+    return names.size() + descriptions.size() + (name_offsets.size() + description_offsets.size()) * sizeof(int);
+}
+
+// Score the allowed rows of one chunk, runs on a pool thread
+FuzzySearch::ChunkResult FuzzySearch::scoreChunk(const Chunk &chunk)
+{
+    const FuzzySearch *search = chunk.search;
+    QVector<Match> matches;
+    for (int id = chunk.begin; id < chunk.end; ++id) {
+        if (!chunk.allowed->testBit(id)) {
+            continue;
+        }
+        int name_start = search->name_offsets.at(id);
+        int name_length = search->name_offsets.at(id + 1) - name_start - 1;
+        int description_start = search->description_offsets.at(id);
+        int description_length = search->description_offsets.at(id + 1) - description_start - 1;
+        int name_score = score(search->names.constData() + name_start, name_length, chunk.needle, true);
+        int description_score = score(search->descriptions.constData() + description_start, description_length,
+                                      chunk.needle, false); // letters scattered over a description say nothing
+        if (name_score == NoMatch && description_score == NoMatch) {
+            continue;
+        }
+        Match match = {id, 2 * name_score + description_score, name_length};
+        matches << match;
+    }
+    ChunkResult result = {matches, matches.size()};
+    keepBest(&result.matches, chunk.limit);
+    return result;
+}
+
+// Score of needle in a '\0' terminated lower-cased text, NoMatch if it isn't found
+int FuzzySearch::score(const char *text, int length, const QByteArray &needle, bool subsequence)
+{
+    const char *found = strstr(text, needle.constData());
+    if (found == text) {
+        return (length == needle.size()) ? Exact : Prefix;
+    }
+    if (found) {
+        for (const char *p = found; p; p = strstr(p + 1, needle.constData())) {
+            if (!isalnum(uchar(p[-1]))) {
+                return WordStart;
+            }
+        }
+        return Substring;
+    }
+    if (!subsequence) {
+        return NoMatch;
+    }
+
+    // all the characters in order, the fewer characters skipped in between the better
+    const char *end = text + length;
+    const char *p = text;
+    const char *first = 0;
+    for (int i = 0; i < needle.size(); ++i) {
+        p = static_cast<const char *>(memchr(p, needle.at(i), end - p));
+        if (!p) {
+            return NoMatch;
+        }
+        if (!first) {
+            first = p;
+        }
+        ++p;
+    }
+    int skipped = (p - first) - needle.size();
+    return Subsequence - qMin(skipped, Subsequence - 1);
+}
+
+bool FuzzySearch::better(const Match &a, const Match &b)
+{
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    if (a.length != b.length) {
+        return a.length < b.length;
+    }
+    return a.id < b.id;
+}
+
+// Keep the best limit matches, in no particular order
+void FuzzySearch::keepBest(QVector<Match> *matches, int limit)
+{
+    if (matches->size() > limit) {
+        std::nth_element(matches->begin(), matches->begin() + limit - 1, matches->end(), better);
+        matches->resize(limit);
+    }
+}
@@ -0,0 +1,81 @@
+/**********************************************************************
+ *  fuzzysearch.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef FUZZYSEARCH_H
+#define FUZZYSEARCH_H
+
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+
+#include <bitset.h>
+
+// Ranked search over package names and short descriptions. A match is scored exact > prefix > word start >
+// substring > subsequence (names only), a name match counts twice as much as the same description match.
+// The lower-cased texts are kept in two contiguous buffers so that scoring a row is a couple of memchr/strstr
+// scans, and the rows are scored in parallel chunks that each keep only their best matches
+class FuzzySearch
+{
+public:
+    FuzzySearch();
+    FuzzySearch(const QStringList &names, const QStringList &descriptions);
+
+    // ids of the best matches, best first; total is set to the number of matches before the limit
+    QVector<int> find(const QString &text, const Bitset &allowed, int limit, int *total = 0) const;
+    qint64 memoryUsage() const; // in bytes
+
+private:
+    enum Score { NoMatch = 0, Subsequence = 200, Substring = 400, WordStart = 600, Prefix = 800, Exact = 1000 };
+    struct Match {
+        int id;
+        int score;
+        int length; // of the name, shorter names go first on equal scores
+    };
+    struct Chunk {
+        const FuzzySearch *search;
+        const Bitset *allowed;
+        QByteArray needle;
+        int begin;
+        int end;
+        int limit;
+    };
+    struct ChunkResult {
+        QVector<Match> matches; // the best ones
+        int total;
+    };
+
+    int count;
+    QByteArray names; // lower-cased UTF-8 names, each one followed by '\0'
+    QByteArray descriptions; // same for the descriptions
+    QVector<int> name_offsets; // start of each name, one extra entry at the end
+    QVector<int> description_offsets;
+
+    static ChunkResult scoreChunk(const Chunk &chunk);
+    static int score(const char *text, int length, const QByteArray &needle, bool subsequence);
+    static bool better(const Match &a, const Match &b);
+    static void keepBest(QVector<Match> *matches, int limit);
+};
+
+#endif // FUZZYSEARCH_H
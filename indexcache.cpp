@@ -0,0 +1,128 @@
+/**********************************************************************
+ *  indexcache.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "indexcache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+
+#include <QDebug>
+
+IndexCache::IndexCache(const QString &dir, qint64 max_size) :
+    dir(dir),
+    max_size(max_size),
+    hits(0),
+    misses(0),
+    settings(dir + "/index.conf", QSettings::IniFormat)
+{
+    QDir().mkpath(dir);
+}
+
+// Return true if there is a cached file for the url
+bool IndexCache::contains(const QUrl &url)
+{
+    return settings.contains(key(url) + "/url") && QFile::exists(fileName(url));
+}
+
+// Path of the cached file for the url
+QString IndexCache::fileName(const QUrl &url)
+{
+    return dir + "/" + key(url);
+}
+
+// Cached file was validated by the server
+void IndexCache::hit(const QUrl &url)
+{
+    ++hits;
+    settings.setValue(key(url) + "/last_used", QDateTime::currentMSecsSinceEpoch());
+}
+
+void IndexCache::logStats()
+{
+    qDebug() << "index cache hits:" << hits << "misses:" << misses;
+}
+
+// Make the request conditional if we have a cached copy
+void IndexCache::prepareRequest(QNetworkRequest *request)
+{
+    QUrl url = request->url();
+    if (!contains(url)) {
+        return;
+    }
+    QString k = key(url);
+    QString etag = settings.value(k + "/etag").toString();
+    QString last_modified = settings.value(k + "/last_modified").toString();
+    if (!etag.isEmpty()) {
+        request->setRawHeader("If-None-Match", etag.toLatin1());
+    }
+    if (!last_modified.isEmpty()) {
+        request->setRawHeader("If-Modified-Since", last_modified.toLatin1());
+    }
+}
+
+// Record the validators of a newly downloaded file and make room for it
+void IndexCache::store(const QUrl &url, QNetworkReply *reply)
+{
+    ++misses;
+    QString k = key(url);
+    settings.beginGroup(k);
+    settings.setValue("url", url.toString());
+    settings.setValue("etag", reply ? QString(reply->rawHeader("ETag")) : QString());
+    settings.setValue("last_modified", reply ? QString(reply->rawHeader("Last-Modified")) : QString());
+    settings.setValue("size", QFile(fileName(url)).size());
+    settings.setValue("last_used", QDateTime::currentMSecsSinceEpoch());
+    settings.endGroup();
+    evict(k);
+}
+
+// Key used for file name and settings group
+QString IndexCache::key(const QUrl &url)
+{
+    return QCryptographicHash::hash(url.toString().toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+// Remove least recently used files until the cache fits in max_size
+void IndexCache::evict(const QString &keep_key)
+{
+    qint64 total = 0;
+    QMap<qint64, QString> by_last_used;
+    foreach (const QString &k, settings.childGroups()) {
+        total += settings.value(k + "/size").toLongLong();
+        by_last_used.insertMulti(settings.value(k + "/last_used").toLongLong(), k);
+    }
+    QMap<qint64, QString>::const_iterator i = by_last_used.constBegin();
+    for (; total > max_size && i != by_last_used.constEnd(); ++i) {
+        if (i.value() == keep_key) {
+            continue;
+        }
+        qDebug() << "evicting from index cache:" << settings.value(i.value() + "/url").toString();
+        total -= settings.value(i.value() + "/size").toLongLong();
+        QFile::remove(dir + "/" + i.value());
+        settings.remove(i.value());
+    }
+    settings.sync();
+}
@@ -0,0 +1,57 @@
+/**********************************************************************
+ *  indexcache.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef INDEXCACHE_H
+#define INDEXCACHE_H
+
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSettings>
+#include <QUrl>
+
+// Persistent cache of downloaded index files, validated with ETag/Last-Modified, evicts least recently used
+class IndexCache
+{
+public:
+    IndexCache(const QString &dir, qint64 max_size = 256 * 1024 * 1024);
+
+    bool contains(const QUrl &url);
+    QString fileName(const QUrl &url);
+    void hit(const QUrl &url); // server returned 304, cached file is current
+    void logStats();
+    void prepareRequest(QNetworkRequest *request); // add If-None-Match/If-Modified-Since
+    void store(const QUrl &url, QNetworkReply *reply = 0); // new file was saved at fileName(url), reply has the validators
+
+private:
+    QString dir;
+    qint64 max_size;
+    int hits;
+    int misses;
+    QSettings settings;
+
+    QString key(const QUrl &url);
+    void evict(const QString &keep_key);
+};
+
+#endif // INDEXCACHE_H
@@ -0,0 +1,758 @@
+/**********************************************************************
+ *  indexdownloader.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "indexdownloader.h"
+
+#include <QCryptographicHash>
+#include <QTimer>
+
+#include <pdiff.h>
+
+#include <QDebug>
+
+IndexDownloader::IndexDownloader(FetchScheduler *scheduler, QObject *parent) :
+    QObject(parent),
+    scheduler(scheduler)
+{
+    manager = new QNetworkAccessManager(this);
+    connect(scheduler, &FetchScheduler::released, this, &IndexDownloader::onSlotReleased, Qt::QueuedConnection);
+    cache = new IndexCache("/var/cache/mx-package-manager/indexes");
+    fetching = 0;
+    fetch_next = 0;
+    fetch_use_cache = false;
+    running = 0;
+    cancelled = false;
+    max_attempts = 5;
+    time_limit = new Watchdog("index", 300, 30, this);
+    connect(time_limit, &Watchdog::expired, this, &IndexDownloader::cancel);
+}
+
+IndexDownloader::~IndexDownloader()
+{
+    cancel();
+    clearTransfers();
+    delete cache;
+}
+
+// Start the downloads at once, as far as the scheduler allows, and wait for them.
+// Requests are conditional when the file is cached, new data goes to a .part file until complete.
+// By-hash files never change, they are not requested again once cached.
+// When the repo publishes PDiffs an uncompressed copy is kept and later updated with the patches only.
+// Failed transfers are retried with exponential backoff, resuming from the data already received
+bool IndexDownloader::download(const QString &dist_url, const QStringList &targets)
+{
+    clearTransfers();
+    cancelled = false;
+    running = 0;
+    bytes_received = 0;
+    time_limit->start();
+
+    bool by_hash;
+    QMap<QString, IndexFile> files = readRelease(dist_url, &by_hash);
+    if (cancelled) {
+        time_limit->stop();
+        return false;
+    }
+    QStringList extensions;
+    extensions << ".xz" << ".gz" << "";
+    foreach (const QString &target, targets) {
+        Transfer transfer;
+        QString file_name = target + ".gz"; // used when the Release file is not available
+        transfer.size = -1;
+        foreach (const QString &extension, extensions) {
+            if (files.contains(target + extension) && (transfer.size == -1 || files.value(target + extension).size < transfer.size)) {
+                file_name = target + extension;
+                transfer.size = files.value(file_name).size;
+            }
+        }
+        transfer.format = Decompressor::formatFor(file_name);
+        transfer.sha256 = files.value(file_name).sha256;
+        transfer.by_hash = by_hash && !transfer.sha256.isEmpty();
+        if (transfer.by_hash) {
+            transfer.url = QUrl(dist_url + "/" + target.section("/", 0, -2) + "/by-hash/SHA256/" + transfer.sha256);
+        } else {
+            transfer.url = QUrl(dist_url + "/" + file_name);
+        }
+        transfer.name = dist_url.section("/", -1) + "/" + target.section("/", 0, 0);
+        transfer.file = new QFile(cache->fileName(transfer.url) + ".part");
+        if (files.contains(target + ".diff/Index") && transfer.format != Decompressor::Plain) {
+            transfer.plain_url = QUrl(dist_url + "/" + target);
+            transfer.plain_file = new QFile(cache->fileName(transfer.plain_url) + ".part");
+        } else {
+            transfer.plain_file = 0;
+        }
+        transfer.reply = 0;
+        transfer.decompressor = 0;
+        transfer.parser = 0;
+        transfer.hash = new QCryptographicHash(QCryptographicHash::Sha256);
+        transfer.retry_timer = new QTimer(this);
+        transfer.retry_timer->setSingleShot(true);
+        connect(transfer.retry_timer, &QTimer::timeout, this, &IndexDownloader::onRetryTimeout);
+        transfer.offset = 0;
+        transfer.attempts = 0;
+        transfer.pending = false;
+        transfer.checked = false;
+        transfer.restart = false;
+        transfer.received = 0;
+        transfer.total = 0;
+        transfer.ok = false;
+        transfer.modified = true;
+        transfers << transfer;
+    }
+    for (int i = 0; i < transfers.size(); ++i) {
+        Transfer &transfer = transfers[i];
+        if (transfer.by_hash && cache->contains(transfer.url)) {
+            cache->hit(transfer.url);
+            transfer.ok = true;
+            transfer.modified = false;
+        } else if (transfer.plain_file && cache->contains(transfer.plain_url)) {
+            transfer.ok = patch(&transfer, QUrl(transfer.plain_url.toString() + ".diff/Index"));
+        }
+        if (cancelled) {
+            break;
+        }
+        if (transfer.ok) {
+            continue;
+        }
+        qDebug() << "index:" << transfer.url.toString();
+        transfer.pending = true;
+        ++running;
+    }
+    startPending();
+    if (running > 0) {
+        loop.exec();
+    }
+    time_limit->stop();
+
+    bool ok = !cancelled;
+    for (int i = 0; i < transfers.size(); ++i) {
+        ok = ok && transfers.at(i).ok;
+        delete transfers.at(i).file;
+        delete transfers.at(i).plain_file;
+        transfers[i].file = 0;
+        transfers[i].plain_file = 0;
+    }
+    qDebug() << "index download:" << bytes_received << "bytes transferred";
+    cache->logStats();
+    return ok;
+}
+
+int IndexDownloader::count()
+{
+    return transfers.size();
+}
+
+bool IndexDownloader::isModified(int index)
+{
+    return transfers.at(index).modified;
+}
+
+// Name of the downloaded file, used for progress display
+QString IndexDownloader::name(int index)
+{
+    return transfers.at(index).name;
+}
+
+qint64 IndexDownloader::received(int index)
+{
+    return transfers.at(index).received;
+}
+
+qint64 IndexDownloader::total(int index)
+{
+    return transfers.at(index).total;
+}
+
+void IndexDownloader::setCacheDir(const QString &dir)
+{
+    delete cache;
+    cache = new IndexCache(dir);
+}
+
+const Watchdog *IndexDownloader::watchdog()
+{
+    return time_limit;
+}
+
+// Merge the parsed packages, files that were not modified are parsed from the cache only when needed here.
+// The parsers are released, so after this the packages are only held by the caller
+QMap<QString, QStringList> IndexDownloader::packages()
+{
+    QMap<QString, QStringList> map;
+    for (int i = 0; i < transfers.size(); ++i) {
+        Transfer &transfer = transfers[i];
+        if (!transfer.modified) {
+            delete transfer.parser;
+            transfer.parser = new PackagesParser();
+            if (!parseFile(cache->fileName(transfer.url), transfer.format, transfer.parser)) {
+                qDebug() << "Could not read cached file for: " << transfer.url.toString();
+            }
+            transfer.modified = true; // parsed now, don't do it again
+        }
+        if (transfer.parser) {
+            map.unite(transfer.parser->packages());
+            delete transfer.parser;
+            transfer.parser = 0;
+        }
+    }
+    return map;
+}
+
+int IndexDownloader::parsedCount()
+{
+    int count = 0;
+    foreach (const Transfer &transfer, transfers) {
+        if (transfer.parser) {
+            count += transfer.parser->count();
+        }
+    }
+    return count;
+}
+
+// Only the files being downloaded are looked at, cached files that turn out to be current are parsed by packages()
+QMap<QString, QStringList> IndexDownloader::parsedPackages()
+{
+    QMap<QString, QStringList> map;
+    foreach (const Transfer &transfer, transfers) {
+        if (transfer.parser) {
+            map.unite(transfer.parser->packages());
+        }
+    }
+    return map;
+}
+
+// Abort all the downloads
+void IndexDownloader::cancel()
+{
+    if (running == 0 && fetching == 0) {
+        return;
+    }
+    qDebug() << "cancel index download";
+    cancelled = true;
+    fetching -= fetch_urls.size() - fetch_next; // not started
+    fetch_next = fetch_urls.size();
+    foreach (QNetworkReply *reply, fetch_replies) {
+        if (!reply->isFinished()) {
+            reply->abort(); // emits finished
+        }
+    }
+    for (int i = 0; i < transfers.size(); ++i) {
+        if (transfers.at(i).reply) {
+            transfers.at(i).reply->abort(); // emits finished
+        } else if (transfers.at(i).retry_timer->isActive() || transfers.at(i).pending) {
+            transfers.at(i).retry_timer->stop();
+            transfers[i].pending = false;
+            --running;
+        }
+    }
+    if (running == 0 && fetching == 0) {
+        loop.quit();
+    }
+}
+
+void IndexDownloader::onDownloadProgress(qint64 received, qint64 total)
+{
+    int i = indexOf(qobject_cast<QNetworkReply *>(sender()));
+    if (i == -1) {
+        return;
+    }
+    Transfer &transfer = transfers[i];
+    transfer.received = transfer.offset + received;
+    transfer.total = (total > 0) ? transfer.offset + total : transfer.size;
+    emit progress();
+}
+
+void IndexDownloader::onReadyRead()
+{
+    int i = indexOf(qobject_cast<QNetworkReply *>(sender()));
+    if (i == -1) {
+        return;
+    }
+    if (!receive(&transfers[i])) {
+        transfers[i].reply->abort();
+    }
+}
+
+void IndexDownloader::onReplyFinished()
+{
+    int i = indexOf(qobject_cast<QNetworkReply *>(sender()));
+    if (i == -1) {
+        return;
+    }
+    Transfer &transfer = transfers[i];
+    scheduler->release(transfer.url);
+    int status = transfer.reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    bool not_modified = (status == 304);
+    bool ok = (transfer.reply->error() == QNetworkReply::NoError);
+    if (ok && !not_modified) {
+        ok = receive(&transfer) && transfer.decompressor->isFinished() && verify(&transfer);
+        transfer.parser->finish();
+    }
+    transfer.file->close();
+    if (transfer.plain_file) {
+        transfer.plain_file->close();
+    }
+    QNetworkReply::NetworkError error = transfer.reply->error();
+    QString error_string = ok ? QString() : transfer.reply->errorString();
+    if (status == 416) { // the partial file doesn't fit the one on the server
+        transfer.restart = true;
+    }
+    if (ok && not_modified) {
+        transfer.modified = false;
+        transfer.file->remove();
+        cache->hit(transfer.url);
+    } else if (ok) {
+        QString cache_file = cache->fileName(transfer.url);
+        QFile::remove(cache_file);
+        transfer.file->rename(cache_file);
+        cache->store(transfer.url, transfer.reply);
+    }
+    if (transfer.plain_file) {
+        if (ok && !not_modified) { // base for the next PDiff update
+            QFile::remove(cache->fileName(transfer.plain_url));
+            transfer.plain_file->rename(cache->fileName(transfer.plain_url));
+            cache->store(transfer.plain_url);
+        } else {
+            transfer.plain_file->remove();
+        }
+    }
+    transfer.reply->deleteLater();
+    transfer.reply = 0;
+    transfer.ok = ok;
+
+    if (!ok) {
+        qDebug() << "Download of " << transfer.url.toString() << " failed: " << error_string;
+        bool retry = !cancelled && transfer.attempts < max_attempts &&
+                error != QNetworkReply::ContentNotFoundError && error != QNetworkReply::ContentAccessDenied;
+        if (retry) {
+            int delay = 1000 << (transfer.attempts - 1); // 1, 2, 4, 8 s
+            qDebug() << "Retrying in" << delay << "ms";
+            transfer.retry_timer->start(delay);
+            return;
+        }
+        if (!transfer.by_hash || transfer.restart) { // partial by-hash files can be resumed next time
+            transfer.file->remove();
+        }
+        if (!cancelled) {
+            cancel(); // no point waiting for the other components
+        }
+    }
+    if (--running == 0) {
+        loop.quit();
+    }
+}
+
+// Queue the next attempt of a failed transfer
+void IndexDownloader::onRetryTimeout()
+{
+    for (int i = 0; i < transfers.size(); ++i) {
+        if (transfers.at(i).retry_timer == sender()) {
+            transfers[i].pending = true;
+            startPending();
+            return;
+        }
+    }
+}
+
+void IndexDownloader::onFetchFinished()
+{
+    int i = fetch_replies.indexOf(qobject_cast<QNetworkReply *>(sender()));
+    if (i != -1) {
+        scheduler->release(fetch_urls.at(i));
+    }
+    if (--fetching == 0) {
+        loop.quit();
+    }
+}
+
+// A connection slot is free, start what is waiting for one
+void IndexDownloader::onSlotReleased()
+{
+    startFetches();
+    startPending();
+}
+
+void IndexDownloader::clearTransfers()
+{
+    for (int i = 0; i < transfers.size(); ++i) {
+        delete transfers.at(i).plain_file;
+        delete transfers.at(i).decompressor;
+        delete transfers.at(i).parser;
+        delete transfers.at(i).hash;
+        delete transfers.at(i).retry_timer;
+    }
+    transfers.clear();
+}
+
+// Fetch small files at the same time, as far as the scheduler allows. Returns their content or empty
+// arrays for the ones that failed. With use_cache the requests are conditional and the files are kept in the cache
+QList<QByteArray> IndexDownloader::fetch(const QList<QUrl> &urls, bool use_cache)
+{
+    fetch_urls = urls;
+    fetch_use_cache = use_cache;
+    fetch_next = 0;
+    fetching = urls.size();
+    startFetches();
+    if (fetching > 0) {
+        loop.exec();
+    }
+
+    QList<QByteArray> result;
+    for (int i = 0; i < urls.size(); ++i) {
+        QNetworkReply *reply = fetch_replies.value(i);
+        QUrl url = urls.at(i);
+        QByteArray data;
+        if (!reply) { // cancelled before it started
+            result << data;
+            continue;
+        }
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
+            qDebug() << "Download of " << url.toString() << " failed: " << reply->errorString();
+            result << data;
+            continue;
+        }
+        QFile file(cache->fileName(url));
+        if (use_cache && reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+            if (file.open(QFile::ReadOnly)) {
+                data = file.readAll();
+            }
+            cache->hit(url);
+            result << data;
+            continue;
+        }
+        data = reply->readAll();
+        bytes_received += data.size();
+        if (use_cache && file.open(QFile::WriteOnly | QFile::Truncate)) {
+            file.write(data);
+            file.close();
+            cache->store(url, reply);
+        }
+        result << data;
+    }
+    fetch_replies.clear();
+    fetch_urls.clear();
+    fetch_next = 0;
+    fetching = 0;
+    return result;
+}
+
+int IndexDownloader::indexOf(QNetworkReply *reply)
+{
+    if (!reply) {
+        return -1;
+    }
+    for (int i = 0; i < transfers.size(); ++i) {
+        if (transfers.at(i).reply == reply) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Decompress and parse a cached file in chunks
+bool IndexDownloader::parseFile(const QString &file_name, Decompressor::Format format, PackagesParser *parser)
+{
+    QFile file(file_name);
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    Decompressor decompressor(format);
+    while (!file.atEnd()) {
+        QByteArray out;
+        if (!decompressor.feed(file.read(64 * 1024), &out)) {
+            return false;
+        }
+        parser->feed(out);
+    }
+    parser->finish();
+    return decompressor.isFinished();
+}
+
+// Update the cached uncompressed index with the patches listed in Packages.diff/Index.
+// Returns false if a full download is needed
+bool IndexDownloader::patch(Transfer *transfer, const QUrl &index_url)
+{
+    PDiff pdiff;
+    if (!pdiff.parseIndex(fetch(QList<QUrl>() << index_url, true).at(0))) {
+        return false;
+    }
+    QFile file(cache->fileName(transfer->plain_url));
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+    QByteArray hash = QCryptographicHash::hash(data, pdiff.algorithm()).toHex();
+    if (hash == pdiff.currentHash()) { // the copy we have is current, it's parsed when needed
+        cache->hit(transfer->plain_url);
+        transfer->url = transfer->plain_url;
+        transfer->format = Decompressor::Plain;
+        transfer->modified = false;
+        return true;
+    }
+
+    QList<PDiff::Patch> patches = pdiff.patchesFrom(hash);
+    if (patches.isEmpty()) {
+        qDebug() << "Cached index is too old for PDiffs:" << transfer->name;
+        return false;
+    }
+    QList<QUrl> urls;
+    foreach (const PDiff::Patch &patch, patches) {
+        urls << QUrl(index_url.toString().section("/", 0, -2) + "/" + patch.name + ".gz");
+    }
+    QList<QByteArray> downloads = fetch(urls, false);
+    QList<QByteArray> lines = data.split('\n');
+    lines.removeLast(); // the file ends with a new line
+    data.clear();
+    for (int i = 0; i < patches.size(); ++i) {
+        const PDiff::Patch &patch = patches.at(i);
+        if (downloads.at(i).isEmpty() || (!patch.download_hash.isEmpty() &&
+                QCryptographicHash::hash(downloads.at(i), pdiff.algorithm()).toHex() != patch.download_hash)) {
+            qDebug() << "Could not get patch" << patch.name << "for" << transfer->name;
+            return false;
+        }
+        Decompressor decompressor(Decompressor::Gzip);
+        QByteArray script;
+        if (!decompressor.feed(downloads.at(i), &script) || !decompressor.isFinished() || (!patch.patch_hash.isEmpty() &&
+                QCryptographicHash::hash(script, pdiff.algorithm()).toHex() != patch.patch_hash) || !PDiff::apply(&lines, script)) {
+            qDebug() << "Could not apply patch" << patch.name << "for" << transfer->name;
+            return false;
+        }
+    }
+    foreach (const QByteArray &line, lines) {
+        data += line + '\n';
+    }
+    if (QCryptographicHash::hash(data, pdiff.algorithm()).toHex() != pdiff.currentHash()) {
+        qDebug() << "Hash sum mismatch after patching" << transfer->name;
+        return false;
+    }
+
+    QFile part(cache->fileName(transfer->plain_url) + ".part");
+    if (!part.open(QFile::WriteOnly | QFile::Truncate) || part.write(data) != data.size()) {
+        part.remove();
+        return false;
+    }
+    part.close();
+    QFile::remove(cache->fileName(transfer->plain_url));
+    part.rename(cache->fileName(transfer->plain_url));
+    cache->store(transfer->plain_url);
+    qDebug() << "Applied" << patches.size() << "PDiffs to" << transfer->name;
+
+    transfer->parser = new PackagesParser();
+    transfer->parser->feed(data);
+    transfer->parser->finish();
+    transfer->modified = true;
+    return true;
+}
+
+// Read the list of index files from InRelease (or Release), by_hash is set if the repo serves files by hash
+QMap<QString, IndexDownloader::IndexFile> IndexDownloader::readRelease(const QString &dist_url, bool *by_hash)
+{
+    QMap<QString, IndexFile> files;
+    *by_hash = false;
+    QByteArray data = fetch(QList<QUrl>() << QUrl(dist_url + "/InRelease"), true).at(0);
+    if (data.isEmpty() && !cancelled) {
+        data = fetch(QList<QUrl>() << QUrl(dist_url + "/Release"), true).at(0);
+    }
+    bool in_sha256 = false;
+    foreach (const QByteArray &line, data.split('\n')) {
+        if (line.startsWith(' ')) { // " <hash> <size> <path>" lines of the checksum sections
+            if (in_sha256) {
+                QList<QByteArray> fields = line.simplified().split(' ');
+                if (fields.size() == 3) {
+                    IndexFile file;
+                    file.sha256 = fields.at(0);
+                    file.size = fields.at(1).toLongLong();
+                    files.insert(QString(fields.at(2)), file);
+                }
+            }
+            continue;
+        }
+        in_sha256 = line.startsWith("SHA256:");
+        if (line.trimmed() == "Acquire-By-Hash: yes") {
+            *by_hash = true;
+        }
+    }
+    return files;
+}
+
+// Start the next fetches the scheduler has room for, in order
+void IndexDownloader::startFetches()
+{
+    while (fetch_next < fetch_urls.size() && scheduler->acquire(fetch_urls.at(fetch_next))) {
+        QNetworkRequest request(fetch_urls.at(fetch_next));
+        if (fetch_use_cache) {
+            cache->prepareRequest(&request);
+        }
+        QNetworkReply *reply = manager->get(request);
+        connect(reply, &QNetworkReply::downloadProgress, time_limit, &Watchdog::kick);
+        connect(reply, &QNetworkReply::finished, this, &IndexDownloader::onFetchFinished);
+        fetch_replies << reply;
+        ++fetch_next;
+    }
+}
+
+// Start the waiting transfers the scheduler has room for
+void IndexDownloader::startPending()
+{
+    for (int i = 0; i < transfers.size(); ++i) {
+        Transfer &transfer = transfers[i];
+        if (!transfer.pending || !scheduler->acquire(transfer.url)) {
+            continue;
+        }
+        transfer.pending = false;
+        if (!startTransfer(&transfer)) {
+            scheduler->release(transfer.url);
+            cancel();
+            if (--running == 0) {
+                loop.quit();
+            }
+            return;
+        }
+    }
+}
+
+// Read the data of the reply, on the first read check if the server sent the range we asked for
+bool IndexDownloader::receive(Transfer *transfer)
+{
+    if (!transfer->checked) {
+        transfer->checked = true;
+        QByteArray etag = transfer->reply->rawHeader("ETag");
+        transfer->validator = etag.startsWith("W/") ? transfer->reply->rawHeader("Last-Modified") : etag; // weak ETags can't be used in If-Range
+        if (transfer->offset > 0 && transfer->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+            qDebug() << "Server sent the whole file:" << transfer->url.toString();
+            transfer->file->resize(0);
+            resetDecoding(transfer);
+        }
+    }
+    QByteArray data = transfer->reply->readAll();
+    bytes_received += data.size();
+    transfer->file->write(data);
+    transfer->hash->addData(data);
+    if (!process(transfer, data)) {
+        transfer->restart = true;
+        return false;
+    }
+    return true;
+}
+
+// Start decompressing and parsing from the beginning of the file
+void IndexDownloader::resetDecoding(Transfer *transfer)
+{
+    delete transfer->decompressor;
+    delete transfer->parser;
+    transfer->decompressor = new Decompressor(transfer->format);
+    transfer->parser = new PackagesParser();
+    transfer->hash->reset();
+    transfer->offset = 0;
+    if (transfer->plain_file && transfer->plain_file->isOpen()) {
+        transfer->plain_file->resize(0);
+    }
+}
+
+// Request the file, resume after the data in the .part file if it's from the same version of the file.
+// The partial data is decoded again since the decoder state is not kept between attempts
+bool IndexDownloader::startTransfer(Transfer *transfer)
+{
+    if (transfer->plain_file && !transfer->plain_file->open(QFile::WriteOnly | QFile::Truncate)) {
+        qDebug() << "Could not open file: " << transfer->plain_file->fileName();
+        return false;
+    }
+    resetDecoding(transfer);
+    bool resume = !transfer->restart && (transfer->by_hash || !transfer->validator.isEmpty()) && transfer->file->exists();
+    if (resume) {
+        QFile part(transfer->file->fileName());
+        if (part.open(QFile::ReadOnly)) {
+            while (resume && !part.atEnd()) {
+                QByteArray data = part.read(64 * 1024);
+                transfer->hash->addData(data);
+                transfer->offset += data.size();
+                resume = process(transfer, data);
+            }
+        }
+        resume = resume && transfer->offset > 0 && (transfer->size <= 0 || transfer->offset < transfer->size);
+        if (!resume) {
+            resetDecoding(transfer);
+        }
+    }
+    if (!transfer->file->open(resume ? QFile::WriteOnly | QFile::Append : QFile::WriteOnly | QFile::Truncate)) {
+        qDebug() << "Could not open file: " << transfer->file->fileName();
+        return false;
+    }
+    transfer->restart = false;
+    transfer->checked = false;
+    ++transfer->attempts;
+
+    QNetworkRequest request(transfer->url);
+    if (resume) {
+        qDebug() << "Resuming" << transfer->url.toString() << "at" << transfer->offset;
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(transfer->offset) + "-");
+        if (!transfer->validator.isEmpty()) {
+            request.setRawHeader("If-Range", transfer->validator);
+        }
+    } else {
+        cache->prepareRequest(&request);
+    }
+    transfer->reply = manager->get(request);
+    connect(transfer->reply, &QNetworkReply::downloadProgress, this, &IndexDownloader::onDownloadProgress);
+    connect(transfer->reply, &QNetworkReply::downloadProgress, time_limit, &Watchdog::kick);
+    connect(transfer->reply, &QNetworkReply::readyRead, this, &IndexDownloader::onReadyRead);
+    connect(transfer->reply, &QNetworkReply::finished, this, &IndexDownloader::onReplyFinished);
+    return true;
+}
+
+// Check the complete file against the size and hash from the Release file
+bool IndexDownloader::verify(Transfer *transfer)
+{
+    if (transfer->sha256.isEmpty()) {
+        return true;
+    }
+    qint64 size = transfer->file->size();
+    QByteArray sha256 = transfer->hash->result().toHex();
+    if (size != transfer->size || sha256 != transfer->sha256) {
+        qDebug() << "Hash sum mismatch for" << transfer->url.toString() << "size:" << size << "expected:" << transfer->size;
+        transfer->restart = true;
+        return false;
+    }
+    return true;
+}
+
+// Decompress newly arrived data and pass it to the parser
+bool IndexDownloader::process(Transfer *transfer, const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return true;
+    }
+    QByteArray out;
+    if (!transfer->decompressor->feed(data, &out)) {
+        qDebug() << "Could not decompress: " << transfer->url.toString();
+        return false;
+    }
+    if (transfer->plain_file) {
+        transfer->plain_file->write(out);
+    }
+    transfer->parser->feed(out);
+    return true;
+}
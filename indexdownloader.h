@@ -0,0 +1,148 @@
+/**********************************************************************
+ *  indexdownloader.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef INDEXDOWNLOADER_H
+#define INDEXDOWNLOADER_H
+
+#include <QObject>
+#include <QCryptographicHash>
+#include <QEventLoop>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+
+#include <decompressor.h>
+#include <fetchscheduler.h>
+#include <indexcache.h>
+#include <packagesparser.h>
+#include <watchdog.h>
+
+// Downloads repo index files concurrently through one QNetworkAccessManager into the persistent index cache.
+// The smallest compression listed in the Release file is used and files are fetched by hash when the repo allows it.
+// Data is decompressed and parsed as it arrives, no temporary files or external processes are used.
+// A download is cancelled when it exceeds the "index" deadline or stall limits
+class IndexDownloader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit IndexDownloader(FetchScheduler *scheduler, QObject *parent = 0);
+    ~IndexDownloader();
+
+    // download the targets (e.g. "main/binary-amd64/Packages") of the dist at dist_url (e.g. ".../dists/jessie-backports"),
+    // blocks until all are done, true if all succeeded
+    bool download(const QString &dist_url, const QStringList &targets);
+
+    int count();
+    bool isModified(int index); // false if the server said the cached copy is current
+    QString name(int index);
+    QMap<QString, QStringList> packages(); // parsed packages of all the files of the last download, once
+    int parsedCount(); // number of packages parsedPackages() would return, cheap enough to check on every progress signal
+    QMap<QString, QStringList> parsedPackages(); // packages parsed so far from the data received, while downloading
+    qint64 received(int index);
+    qint64 total(int index);
+    void setCacheDir(const QString &dir); // instead of /var/cache/mx-package-manager/indexes
+    const Watchdog *watchdog(); // tells if the last download timed out
+
+signals:
+    void progress();
+
+public slots:
+    void cancel();
+
+private slots:
+    void onDownloadProgress(qint64 received, qint64 total);
+    void onFetchFinished();
+    void onReadyRead();
+    void onReplyFinished();
+    void onRetryTimeout();
+    void onSlotReleased();
+
+private:
+    struct IndexFile {
+        QByteArray sha256;
+        qint64 size;
+    };
+
+    struct Transfer {
+        QUrl url;
+        QString name;
+        Decompressor::Format format;
+        QByteArray sha256; // from the Release file, empty if not listed
+        qint64 size;
+        bool by_hash;
+        QFile *file;
+        QUrl plain_url; // uncompressed copy kept as base for PDiffs, empty if the repo has none
+        QFile *plain_file;
+        QNetworkReply *reply;
+        Decompressor *decompressor;
+        PackagesParser *parser;
+        QCryptographicHash *hash; // of the compressed data
+        QTimer *retry_timer;
+        QByteArray validator; // ETag or Last-Modified of the partial data, sent as If-Range
+        qint64 offset; // data in the .part file when the request was made
+        int attempts;
+        bool pending; // waiting for a connection slot
+        bool checked; // response status was checked
+        bool restart; // discard the partial data on the next attempt
+        qint64 received;
+        qint64 total;
+        bool ok;
+        bool modified;
+    };
+
+    FetchScheduler *scheduler;
+    IndexCache *cache;
+    QNetworkAccessManager *manager;
+    QEventLoop loop;
+    QList<Transfer> transfers;
+    QList<QUrl> fetch_urls;
+    QList<QNetworkReply *> fetch_replies; // the ones started so far, same order as fetch_urls
+    bool fetch_use_cache;
+    int fetch_next;
+    int fetching;
+    qint64 bytes_received;
+    int running; // transfers not done yet, including those waiting to be retried
+    int max_attempts;
+    bool cancelled;
+    Watchdog *time_limit;
+
+    void clearTransfers();
+    QList<QByteArray> fetch(const QList<QUrl> &urls, bool use_cache);
+    int indexOf(QNetworkReply *reply);
+    bool parseFile(const QString &file_name, Decompressor::Format format, PackagesParser *parser);
+    bool patch(Transfer *transfer, const QUrl &index_url);
+    QMap<QString, IndexFile> readRelease(const QString &dist_url, bool *by_hash);
+    bool process(Transfer *transfer, const QByteArray &data);
+    bool receive(Transfer *transfer);
+    void startFetches();
+    void startPending();
+    void resetDecoding(Transfer *transfer);
+    bool startTransfer(Transfer *transfer);
+    bool verify(Transfer *transfer);
+};
+
+#endif // INDEXDOWNLOADER_H
@@ -30,10 +30,12 @@
 
 #include <QFileDialog>
 #include <QScrollBar>
+#include <QSet>
 #include <QTextStream>
 #include <QtXml/QtXml>
 #include <QProgressBar>
 #include <QNetworkAccessManager>
+#include <QNetworkProxy>
 #include <QNetworkReply>
 #include <QImageReader>
 
@@ -52,11 +54,52 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+// Download through apt's proxy (Acquire::http::Proxy) if one is set, otherwise through the one in the environment
+void MainWindow::setProxy()
+{
+    QString apt_proxy = cmd->getOutput("apt-config shell PROXY Acquire::http::Proxy").section("'", 1, 1);
+    QUrl url(apt_proxy);
+    if (apt_proxy.isEmpty() || apt_proxy == "DIRECT" || url.host().isEmpty()) {
+        QNetworkProxyFactory::setUseSystemConfiguration(true);
+        return;
+    }
+    qDebug() << "using apt proxy:" << url.host() << url.port(8080);
+    QNetworkProxy::setApplicationProxy(QNetworkProxy(QNetworkProxy::HttpProxy, url.host(), url.port(8080), url.userName(), url.password()));
+}
+
 // Setup versious items first time program runs
 void MainWindow::setup()
 {
     ui->tabWidget->blockSignals(true);
     cmd = new Cmd(this);
+    setProxy();
+    apt = new AptRunner(this);
+    scheduler = new FetchScheduler(this); // shared by index downloads and .deb prefetching
+    prefetcher = new DebPrefetcher(scheduler, this);
+    downloader = new IndexDownloader(scheduler, this);
+    connect(downloader, &IndexDownloader::progress, this, &MainWindow::indexProgress);
+    repos = RepoConfig::load();
+    QStringList hosts = RepoConfig::aptHosts();
+    foreach (const Repo &repo, repos) {
+        ui->comboRepo->addItem(repo.name);
+        if (!repo.mirrors.isEmpty()) {
+            mirrors.insert(repo.id, new MirrorSelector(repo.id, repo.mirrors, this));
+        }
+        foreach (const QString &uri, QStringList() << repo.uri << repo.source_uri << repo.mirrors) {
+            QString host = QUrl(uri).host();
+            if (!host.isEmpty() && !hosts.contains(host)) {
+                hosts << host;
+            }
+        }
+    }
+    connectivity = new ConnectivityMonitor(hosts, this);
+    connectivity->probe(); // the result is ready by the time it's needed
+    update_limit = new Watchdog("update", 600, 120, this);
+    screenshot_limit = new Watchdog("screenshot", 10, 5, this);
+    prefetch_timer = new QTimer(this);
+    prefetch_timer->setSingleShot(true);
+    prefetch_timer->setInterval(1500);
+    connect(prefetch_timer, &QTimer::timeout, this, &MainWindow::startPrefetch);
     if (cmd->getOutput("arch") == "x86_64") {
         arch = "amd64";
     } else {
@@ -71,40 +114,56 @@ void MainWindow::setup()
     QStringList column_names;
     column_names << "" << "" << tr("Package") << tr("Info") << tr("Description");
     ui->treePopularApps->setHeaderLabels(column_names);
-    ui->treeOther->hideColumn(5); // Status of the package: installed, upgradable, etc
-    ui->treeOther->hideColumn(6); // Displayed status true/false
+    package_model = new PackageModel(this);
+    QSettings config("/etc/mx-package-manager.conf", QSettings::IniFormat);
+    stores.setMaxCost(config.value("Cache/package_memory", 128).toInt() * 1024); // in KB
+    search_limit = config.value("Search/max_results", 1000).toInt();
+    ui->treeOther->setModel(package_model);
+    loading_bar = new QProgressBar(this);
+    loading_bar->setMaximum(100);
+    loading_bar->hide();
+    ui->horizontalLayout_2->insertWidget(0, loading_bar);
+    loading_cancel = new QPushButton(tr("Cancel"), this);
+    loading_cancel->hide();
+    connect(loading_cancel, &QPushButton::clicked, this, &MainWindow::cancelDownload);
+    ui->horizontalLayout_2->insertWidget(1, loading_cancel);
+    search_hint = new QLabel(this);
+    search_hint->hide();
+    ui->horizontalLayout_2->addWidget(search_hint);
+    loading = false;
+    published_count = 0;
+    connect(package_model, &PackageModel::checkStateChanged, this, &MainWindow::packageChecked);
     ui->icon->setIcon(QIcon::fromTheme("software-update-available", QIcon(":/icons/software-update-available.png")));
     loadPmFiles();
     refreshPopularApps();
-    connect(ui->searchPopular, &QLineEdit::textChanged, this, &MainWindow::findPackage);
-    connect(ui->searchBox, &QLineEdit::textChanged, this, &MainWindow::findPackageOther);
+    int search_delay = config.value("Search/delay", 200).toInt(); // in ms
+    popular_search_timer = new QTimer(this);
+    popular_search_timer->setSingleShot(true);
+    popular_search_timer->setInterval(search_delay);
+    connect(popular_search_timer, &QTimer::timeout, this, &MainWindow::findPackage);
+    connect(ui->searchPopular, &QLineEdit::textChanged, popular_search_timer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    search_timer = new QTimer(this);
+    search_timer->setSingleShot(true);
+    search_timer->setInterval(search_delay);
+    connect(search_timer, &QTimer::timeout, this, &MainWindow::findPackageOther);
+    connect(ui->searchBox, &QLineEdit::textChanged, search_timer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    search_help = tr("Search names and descriptions, or use terms like:\n"
+                     "  name:text  name=text  name:~regex  (also description, section and version)\n"
+                     "  size<50M  size>=100K\n"
+                     "  installed:yes  upgradable:no  library:no");
+    ui->searchBox->setToolTip(search_help);
+    query_runner = new QueryRunner(this);
+    connect(query_runner, &QueryRunner::rowsReady, this, &MainWindow::queryRows);
+    connect(query_runner, &QueryRunner::limited, this, &MainWindow::queryLimited);
+    connect(query_runner, &QueryRunner::finished, this, &MainWindow::queryFinished);
     ui->searchPopular->setFocus();
-    tree_stable = new QTreeWidget();
-    tree_mx_test = new QTreeWidget();
-    tree_backports = new QTreeWidget();
     updated_once = false;
     warning_displayed = false;
+    updateQueueButton();
     clearUi();
     ui->tabWidget->blockSignals(false);
 }
 
-// Uninstall listed packages
-void MainWindow::uninstall(const QString &names)
-{
-    this->hide();
-    lock_file->unlock();
-    qDebug() << "uninstall list: " << names;
-    QString title = tr("Uninstalling packages...");
-    cmd->run("x-terminal-emulator -T '" + title + "' -e apt-get remove " + names);
-    lock_file->lock();
-    refreshPopularApps();
-    clearCache();
-    this->show();
-    if (ui->tabOtherRepos->isVisible()) {
-        buildPackageLists();
-    }
-}
-
 // Run apt-get update
 bool MainWindow::update()
 {
@@ -112,25 +171,25 @@ bool MainWindow::update()
     setConnections();
     progress->show();
     progress->setLabelText(tr("Running apt-get update... "));
-    if (cmd->run("apt-get update") == 0) {
-        lock_file->lock();
+    int ret;
+    do {
+        ret = cmd->run("apt-get update", 0, update_limit);
+    } while (ret != 0 && retryAfterTimeout(update_limit, tr("apt-get update did not complete.")));
+    lock_file->lock();
+    if (ret == 0) {
         updated_once = true;
         return true;
     }
-    lock_file->lock();
     return false;
 }
 
 // Update interface when done loading info
 void MainWindow::updateInterface()
 {
-    QList<QTreeWidgetItem *> upgr_list = ui->treeOther->findItems("upgradable", Qt::MatchExactly, 5);
-    QList<QTreeWidgetItem *> inst_list = ui->treeOther->findItems("installed", Qt::MatchExactly, 5);
-    ui->labelNumApps->setText(QString::number(ui->treeOther->topLevelItemCount()));
-    ui->labelNumUpgr->setText(QString::number(upgr_list.count()));
-    ui->labelNumInst->setText(QString::number(inst_list.count() + upgr_list.count()));
+    PackageStats stats = package_model->store().stats();
+    showStats(stats);
 
-    if (upgr_list.count() > 0 && ui->radioStable->isChecked()) {
+    if (stats.upgradable > 0 && currentRepo().apt) {
         ui->buttonUpgradeAll->show();
     } else {
         ui->buttonUpgradeAll->hide();
@@ -142,8 +201,30 @@ void MainWindow::updateInterface()
     ui->groupBox->setEnabled(true);
     progress->hide();
     ui->searchBox->setFocus();
-    ui->treeOther->blockSignals(false);
     findPackageOther();
+    for (int i = 0; i < PackageModel::ColumnCount; ++i) {
+        ui->treeOther->resizeColumnToContents(i); // only looks at the rows around the visible ones
+    }
+}
+
+// Show the package counts of the shown repo
+void MainWindow::showStats(const PackageStats &stats)
+{
+    ui->labelNumApps->setText(QString::number(stats.total));
+    ui->labelNumUpgr->setText(QString::number(stats.upgradable));
+    ui->labelNumInst->setText(QString::number(stats.installed));
+}
+
+// Show the package counts of the repos loaded so far in the repo selector, even when their stores were dropped
+void MainWindow::showRepoStats()
+{
+    for (int i = 0; i < repos.size(); ++i) {
+        if (repo_stats.contains(repos.at(i).id)) {
+            PackageStats stats = repo_stats.value(repos.at(i).id);
+            ui->comboRepo->setItemData(i, tr("%1 packages, %2 installed, %3 upgradable")
+                                       .arg(stats.total).arg(stats.installed).arg(stats.upgradable), Qt::ToolTipRole);
+        }
+    }
 }
 
 // Write the name of the apps in a temp file
@@ -169,6 +250,37 @@ void MainWindow::setConnections()
 }
 
 
+// Update progress dialog with the prefetched bytes
+void MainWindow::prefetchProgress(qint64 received, qint64 total)
+{
+    bar->setMaximum(100);
+    bar->setValue(total > 0 ? received * 100 / total : 0);
+}
+
+// Show the run time of the finished script in the progress dialog and keep the output of failed ones
+void MainWindow::scriptFinished(const QString &name, int exit_code, qint64 time, const QString &output)
+{
+    progress->setLabelText(script_label + "\n" + tr("%1 done in %2 s").arg(name).arg(time / 1000.0, 0, 'f', 1));
+    if (exit_code != 0) {
+        script_errors << name + ": " + tr("exit code %1").arg(exit_code) + "\n" + output;
+    }
+}
+
+// Update progress dialog with the number of finished scripts
+void MainWindow::scriptProgress(int done, int total)
+{
+    bar->setMaximum(total);
+    bar->setValue(done);
+}
+
+// Update progress dialog with the status reported by apt-get
+void MainWindow::aptProgress(int percent, const QString &message)
+{
+    bar->setMaximum(100);
+    bar->setValue(percent);
+    progress->setLabelText(message);
+}
+
 // Processes tick emited by Cmd to be used by a progress bar
 void MainWindow::tock(int counter, int duration)
 {
@@ -201,6 +313,35 @@ void MainWindow::loadPmFiles()
         }
         file.close();
     }
+    rejectScriptCycles();
+}
+
+// Drop the "scripts_after" of apps that end up waiting on themselves, their scripts could never run
+void MainWindow::rejectScriptCycles()
+{
+    QHash<QString, QStringList> after;
+    foreach (const QStringList &list, popular_apps) {
+        foreach (const QString &app, list.at(10).split(QRegExp("[,\n]"), QString::SkipEmptyParts)) {
+            after[list.at(1)] << app.trimmed();
+        }
+    }
+    for (int i = 0; i < popular_apps.size(); ++i) {
+        QString name = popular_apps.at(i).at(1);
+        QStringList pending = after.value(name);
+        QSet<QString> seen;
+        while (!pending.isEmpty()) {
+            QString app = pending.takeFirst();
+            if (app == name) {
+                qDebug() << "Ignoring scripts_after of" << name << "-- dependency cycle:" << popular_apps.at(i).at(10);
+                popular_apps[i][10].clear();
+                break;
+            }
+            if (!seen.contains(app)) {
+                seen.insert(app);
+                pending << after.value(app);
+            }
+        }
+    }
 }
 
 // Process dom documents (from .pm files)
@@ -216,6 +357,9 @@ void MainWindow::processDoc(const QDomDocument &doc)
         6 "install_package_names"
         7 "postinstall"
         8 "uninstall_package_names"
+        9 "order_dependent" -- "true" if the app needs its own preinstall/install/postinstall sequence
+        10 "scripts_after" -- apps (one per line or comma separated) whose scripts need to run before this app's scripts
+        11 "scripts_exclusive" -- "true" if the scripts can't run at the same time with other scripts
     */
 
     QString category;
@@ -227,6 +371,9 @@ void MainWindow::processDoc(const QDomDocument &doc)
     QString postinstall;
     QString install_names;
     QString uninstall_names;
+    QString order_dependent;
+    QString scripts_after;
+    QString scripts_exclusive;
     QStringList list;
 
     QDomElement root = doc.firstChildElement("app");
@@ -252,6 +399,12 @@ void MainWindow::processDoc(const QDomDocument &doc)
             postinstall = element.text().trimmed();
         } else if (element.tagName() == "uninstall_package_names") {
             uninstall_names = element.text().trimmed();
+        } else if (element.tagName() == "order_dependent") {
+            order_dependent = element.text().trimmed();
+        } else if (element.tagName() == "scripts_after") {
+            scripts_after = element.text().trimmed();
+        } else if (element.tagName() == "scripts_exclusive") {
+            scripts_exclusive = element.text().trimmed();
         }
     }
     // skip non-installable packages
@@ -259,7 +412,8 @@ void MainWindow::processDoc(const QDomDocument &doc)
         return;
     }
     list << category << name << description << installable << screenshot << preinstall
-         << postinstall << install_names << uninstall_names;
+         << postinstall << install_names << uninstall_names << order_dependent
+         << scripts_after << scripts_exclusive;
     popular_apps << list;
 }
 
@@ -267,7 +421,7 @@ void MainWindow::processDoc(const QDomDocument &doc)
 void MainWindow::refreshPopularApps()
 {
     ui->treePopularApps->clear();
-    ui->treeOther->clear();
+    package_model->clear();
     ui->searchPopular->clear();
     ui->searchBox->clear();
     ui->buttonInstall->setEnabled(false);
@@ -279,7 +433,6 @@ void MainWindow::refreshPopularApps()
 // Setup progress dialog
 void MainWindow::setProgressDialog()
 {
-    timer = new QTimer(this);
     progress = new QProgressDialog(this);
     bar = new QProgressBar(progress);
     progCancel = new QPushButton(tr("Cancel"));
@@ -363,139 +516,125 @@ void MainWindow::displayPopularApps()
 // Display available packages
 void MainWindow::displayPackages(bool force_refresh)
 {
-    QMap<QString, QStringList> list;
-    if(ui->radioMXtest->isChecked()) {
-        if (tree_mx_test->topLevelItemCount() != 0 && !force_refresh) {
-            copyTree(tree_mx_test, ui->treeOther);
-            updateInterface();
-            return;
-        }
-        list = mx_list;
-    } else if (ui->radioBackports->isChecked()) {
-        if (tree_backports->topLevelItemCount() != 0 && !force_refresh) {
-            copyTree(tree_backports, ui->treeOther);
-            updateInterface();
-            return;
-        }
-        list = backports_list;
-    } else if (ui->radioStable->isChecked()) {
-        if (tree_stable->topLevelItemCount() != 0 && !force_refresh) {
-            copyTree(tree_stable, ui->treeOther);
-            updateInterface();
-            return;
-        }
-        list = stable_list;
+    const Repo &repo = currentRepo();
+    if (stores.contains(repo.id) && !force_refresh) {
+        package_model->setStore(*stores.object(repo.id));
+        updateInterface();
+        return;
+    }
+    // the store keeps what it needs, the raw list would keep the strings alive after the store is evicted
+    QMap<QString, QStringList> list = package_lists.take(repo.id);
+    if (published_count == 0) {
+        progress->show();
     }
-    progress->show();
 
     QHash<QString, VersionNumber> hashInstalled; // hash that contains (app_name, VersionNumber) returned by apt-cache policy
     QHash<QString, VersionNumber> hashCandidate; //hash that contains (app_name, VersionNumber) returned by apt-cache policy for candidates
-    QString app_name;
-    QString app_info;
-    QString apps;
-    QString app_ver;
-    QString app_desc;
-    VersionNumber installed;
-    VersionNumber candidate;
-
-    QTreeWidgetItem *widget_item;
-
-    // create a list of apps, create a hash with app_name, app_info
-    QMap<QString, QStringList>::iterator i;
-    for (i = list.begin(); i != list.end(); ++i) {
-        app_name = i.key();
-        apps += app_name + " "; // all the apps
-        app_ver = i.value().at(0);
-        app_desc = i.value().at(1);
-
-        widget_item = new QTreeWidgetItem(ui->treeOther);
-        widget_item->setCheckState(0, Qt::Unchecked);
-        widget_item->setText(2, app_name);
-        widget_item->setText(3, app_ver);
-        widget_item->setText(4, app_desc);
-        widget_item->setText(6, "true"); // all items are displayed till filtered
-    }
-    for (int i = 0; i < ui->treeOther->columnCount(); ++i) {
-        ui->treeOther->resizeColumnToContents(i);
-    }
-    QString tmp_file_name = writeTmpFile(apps);
 
+    // the packages and their search indexes are built once, the stores below only work out the statuses again
+    PackageStore base(list, hashInstalled, hashCandidate, 0);
     if (app_info_list.size() == 0 || force_refresh) {
-        progress->setLabelText(tr("Updating package list..."));
-        setConnections();
-        QString info_installed = cmd->getOutput("LC_ALL=en_US.UTF-8 xargs apt-cache policy <" + tmp_file_name + "|grep Candidate -B2");
-        app_info_list = info_installed.split("--"); // list of installed apps
+        // ask apt in batches that double in size, the statuses found so far are shown after each one
+        app_info_list.clear();
+        QStringList names = list.keys();
+        int batch = first_batch;
+        for (int start = 0; start < names.size(); start += batch, batch *= 2) {
+            if (!showLoadProgress(tr("Updating package list..."), start * 100 / names.size())) {
+                progress->setLabelText(tr("Updating package list..."));
+            }
+            setConnections();
+            QString tmp_file_name = writeTmpFile(QStringList(names.mid(start, batch)).join(" "));
+            QStringList items = cmd->getOutput("LC_ALL=en_US.UTF-8 xargs apt-cache policy <" + tmp_file_name + "|grep Candidate -B2").split("--");
+            app_info_list << items; // list of installed apps
+            readPolicy(items, &hashInstalled, &hashCandidate);
+            if (loading && start + batch < names.size()) {
+                publishPackages(PackageSnapshot(new PackageStore(base, hashInstalled, hashCandidate, start + batch)));
+            }
+        }
+    } else {
+        readPolicy(app_info_list, &hashInstalled, &hashCandidate);
     }
-    // create a hash of name and installed version
-    foreach(const QString &item, app_info_list) {
-        app_name = item.section(":", 0, 0).trimmed();
-        installed = item.section("\n  ", 1, 1).trimmed().section(": ", 1, 1); // Installed version
-        candidate = item.section("\n  ", 2, 2).trimmed().section(": ", 1, 1);
-        hashInstalled.insert(app_name, installed);
-        hashCandidate.insert(app_name, candidate);
+
+    // the view reads the store directly, keep it for reuse; the least recently used ones go first when over the limit
+    PackageSnapshot store(new PackageStore(base, hashInstalled, hashCandidate));
+    stores.insert(repo.id, new PackageSnapshot(store), store->memoryCost());
+    repo_stats.insert(repo.id, store->stats());
+    showRepoStats();
+    if (published_count > 0) {
+        keepViewPosition();
+        package_model->updateStore(store); // keep what was checked in the partial list
+    } else {
+        package_model->setStore(store);
     }
-    for (int i = 0; i < ui->treeOther->columnCount(); ++i) {
-        ui->treeOther->resizeColumnToContents(i);
+    updateInterface();
+}
+
+// Create a hash of name and installed version, and one of name and candidate version, from "apt-cache policy" items
+void MainWindow::readPolicy(const QStringList &items, QHash<QString, VersionNumber> *installed,
+                            QHash<QString, VersionNumber> *candidates)
+{
+    foreach (const QString &item, items) {
+        QString app_name = item.section(":", 0, 0).trimmed();
+        installed->insert(app_name, VersionNumber(item.section("\n  ", 1, 1).trimmed().section(": ", 1, 1)));
+        candidates->insert(app_name, VersionNumber(item.section("\n  ", 2, 2).trimmed().section(": ", 1, 1)));
     }
+}
 
-    // process the entire list of apps
-    QTreeWidgetItemIterator it(ui->treeOther);
-    int upgr_count = 0;
-    int inst_count = 0;
+// Show the packages loaded so far while the list is still being built. The first time this takes the place of
+// the progress dialog, so the list can be searched, filtered and checked; the controls that would start another
+// load stay disabled until stopLoading(). Each call shows at least twice as many packages, or twice as many
+// statuses, as the previous one. Packages apt wasn't asked about yet are Unknown and left out of the status filters
+void MainWindow::publishPackages(const PackageSnapshot &store)
+{
+    if (published_count == 0) {
+        progress->hide(); // its Cancel button is replaced by the one next to the bar
+        loading_bar->setValue(0);
+        loading_bar->show();
+        loading_cancel->setEnabled(progCancel->isEnabled());
+        loading_cancel->show();
+        ui->tabWidget->setTabEnabled(ui->tabWidget->indexOf(ui->tabApps), false);
+        ui->buttonCancel->setEnabled(false);
+        ui->comboFilter->setEnabled(true);
+        ui->searchBox->setFocus();
+        package_model->setStore(store);
+    } else {
+        keepViewPosition();
+        package_model->updateStore(store);
+    }
+    published_count = store->size();
+    showStats(store->stats());
+    updateSelectionButtons();
+    findPackageOther();
+}
 
-    // update tree
-    while (*it) {
-        app_name = (*it)->text(2);
-        if (((app_name.startsWith("lib") && !app_name.startsWith("libreoffice")) || app_name.endsWith("-dev")) && ui->checkHideLibs->isChecked()) {
-            (*it)->setHidden(true);
-        }
-        app_ver = (*it)->text(3);
-        installed = hashInstalled[app_name];
-        candidate = hashCandidate[app_name];
-        VersionNumber repocandidate(app_ver); // candidate from the selected repo, might be different than the one from Stable
-
-        (*it)->setIcon(1, QIcon()); // reset update icon
-        if (installed.toString() == "(none)") {
-            for (int i = 0; i < ui->treeOther->columnCount(); ++i) {
-                (*it)->setToolTip(i, tr("Version ") + candidate.toString() + tr(" in stable repo"));
-            }
-            (*it)->setText(5, "not installed");
-        } else if (installed.toString() == "") {
-            for (int i = 0; i < ui->treeOther->columnCount(); ++i) {
-               (*it)->setToolTip(i, tr("Not available in stable repo"));
-            }
-            (*it)->setText(5, "not installed");
-        } else {
-            inst_count++;
-            if (installed >= repocandidate) {
-                for (int i = 0; i < ui->treeOther->columnCount(); ++i) {
-                    (*it)->setForeground(2, QBrush(Qt::gray));
-                    (*it)->setForeground(4, QBrush(Qt::gray));
-                    (*it)->setToolTip(i, tr("Latest version ") + installed.toString() + tr(" already installed"));
-                }
-                (*it)->setText(5, "installed");
-            } else {
-                (*it)->setIcon(1, QIcon::fromTheme("software-update-available", QIcon(":/icons/software-update-available.png")));
-                for (int i = 0; i < ui->treeOther->columnCount(); ++i) {
-                    (*it)->setToolTip(i, tr("Version ") + installed.toString() + tr(" installed"));
-                }
-                upgr_count++;
-                (*it)->setText(5, "upgradable");
-            }
+// Rows can be shown before the list is complete from now on
+void MainWindow::startLoading()
+{
+    loading = true;
+    published_count = 0;
+}
 
-        }
-        ++it;
-    }
+void MainWindow::stopLoading()
+{
+    loading = false;
+    published_count = 0;
+    loading_bar->hide();
+    loading_cancel->hide();
+    ui->tabWidget->setTabEnabled(ui->tabWidget->indexOf(ui->tabApps), true);
+    ui->buttonCancel->setEnabled(true);
+    updateSelectionButtons();
+}
 
-    // cache trees for reuse
-    if(ui->radioMXtest->isChecked()) {
-        copyTree(ui->treeOther, tree_mx_test);
-    } else if (ui->radioBackports->isChecked()) {
-        copyTree(ui->treeOther, tree_backports);
-    } else if (ui->radioStable->isChecked()) {
-        copyTree(ui->treeOther, tree_stable);
+// Loading progress goes to the bar under the list once rows are shown, returns false if they are not yet
+bool MainWindow::showLoadProgress(const QString &text, int percent)
+{
+    if (published_count == 0) {
+        return false;
     }
-    updateInterface();
+    loading_bar->setFormat(text + " %p%");
+    loading_bar->setValue(percent);
+    loading_cancel->setEnabled(progCancel->isEnabled()); // only what the progress dialog would let cancel
+    return true;
 }
 
 // Display warning for Debian Backports
@@ -528,84 +667,235 @@ void MainWindow::displayWarning()
 void MainWindow::ifDownloadFailed()
 {
     progress->hide();
-    if(ui->radioMXtest->isChecked()) {
-        if (tree_mx_test->topLevelItemCount() != 0) {
-            copyTree(tree_mx_test, ui->treeOther);
-            updateInterface();
-            return;
-        } else {
-            ui->tabWidget->setCurrentWidget(ui->tabApps);
-        }
-    } else if (ui->radioBackports->isChecked()) {
-        if (tree_backports->topLevelItemCount() != 0) {
-            copyTree(tree_backports, ui->treeOther);
-            updateInterface();
-            return;
-        } else {
-            ui->tabWidget->setCurrentWidget(ui->tabApps);
-        }
-    } else if (ui->radioStable->isChecked()) {
-        if (tree_stable->topLevelItemCount() != 0) {
-            copyTree(tree_stable, ui->treeOther);
-            updateInterface();
-            return;
-        } else {
-            ui->tabWidget->setCurrentWidget(ui->tabApps);
-        }
+    if (stores.contains(currentRepo().id)) {
+        package_model->setStore(*stores.object(currentRepo().id));
+        updateInterface();
+    } else {
+        package_model->clear(); // might hold a partial list
+        ui->tabWidget->setCurrentWidget(ui->tabApps);
     }
 }
 
 // Install the list of apps
 void MainWindow::install(const QString &names)
 {
-    if (!checkOnline()) {
+    if (!connectivity->isOnline()) {
         QMessageBox::critical(this, tr("Error"), tr("Internet is not available, won't be able to download the list of packages"));
         return;
     }
-    this->hide();
     lock_file->unlock();
-    QString title = tr("Installing packages...");
-    if (ui->radioBackports->isChecked()) {
-        cmd->run("x-terminal-emulator -T '" +  title + "' -e apt-get install -t jessie-backports --reinstall " + names);
-    } else {
-        cmd->run("x-terminal-emulator -T '" +  title + "' -e apt-get install --reinstall " + names);
+    runApt("install --reinstall " + names, tr("Installing packages..."));
+    lock_file->lock();
+}
+
+// Run apt-get after confirmation, showing its progress in the progress dialog. Return true for success
+bool MainWindow::runApt(const QString &args, const QString &title)
+{
+    QStringList actions;
+    if (apt->simulate(args, &actions) != 0) {
+        QMessageBox msgBox(QMessageBox::Critical, tr("Error"),
+                           tr("apt-get can't perform these operations, please check the details."),
+                           QMessageBox::Close, this);
+        msgBox.setDetailedText(apt->getErrors().join("\n"));
+        msgBox.exec();
+        return false;
+    }
+    if (!actions.isEmpty()) { // nothing to confirm if apt-get has nothing to do
+        QMessageBox msgBox(QMessageBox::Question, title,
+                           tr("%1 package operations will be performed. Do you want to continue?").arg(actions.size()),
+                           QMessageBox::Yes | QMessageBox::No, this);
+        msgBox.setDetailedText(actions.join("\n"));
+        if (msgBox.exec() != QMessageBox::Yes) {
+            return false;
+        }
     }
 
-    lock_file->lock();
-    this->show();
+    connect(apt, &AptRunner::progress, this, &MainWindow::aptProgress, Qt::UniqueConnection);
+    progCancel->setDisabled(true); // don't interrupt dpkg
+    bar->setMaximum(100);
+    bar->setValue(0);
+    progress->setLabelText(title);
+    progress->show();
+    setCursor(QCursor(Qt::BusyCursor));
+    int ret = apt->run(args);
+    setCursor(QCursor(Qt::ArrowCursor));
+    progress->hide();
+
+    if (ret != 0) {
+        QMessageBox msgBox(QMessageBox::Critical, tr("Error"),
+                           tr("There was a problem running apt-get, please check the details."),
+                           QMessageBox::Close, this);
+        msgBox.setDetailedText(apt->getErrors().join("\n") + "\n\n" + apt->getLog());
+        msgBox.exec();
+        return false;
+    }
+    QStringList conffiles = apt->keptConffiles();
+    if (!conffiles.isEmpty()) {
+        QMessageBox msgBox(QMessageBox::Information, title,
+                           tr("Your changes to %1 configuration files were kept. The versions shipped with the packages "
+                              "were saved next to them with the .dpkg-dist extension.").arg(conffiles.size()),
+                           QMessageBox::Ok, this);
+        msgBox.setDetailedText(conffiles.join("\n"));
+        msgBox.exec();
+    }
+    return true;
 }
 
-// install a list of application and run postprocess for each of them.
-void MainWindow::installBatch(const QStringList &name_list)
+// After a network operation timed out tell the user which limit was exceeded and ask whether to try again
+bool MainWindow::retryAfterTimeout(const Watchdog *watchdog, const QString &text)
 {
-    QString postinstall;
+    if (watchdog->reason() == Watchdog::None) { // failed or cancelled for another reason
+        return false;
+    }
+    QMessageBox msgBox(QMessageBox::Warning, tr("Timed out"),
+                       text + "\n\n" + watchdog->message() + "\n" +
+                       tr("The time limits can be raised for slow connections in /etc/mx-package-manager.conf."),
+                       QMessageBox::Retry | QMessageBox::Cancel, progress);
+    return msgBox.exec() == QMessageBox::Retry;
+}
+
+// Commit the queued operations: run the preinstall scripts, do all the installs and removals in one apt-get run,
+// run the postinstall scripts, then refresh the package lists once
+void MainWindow::commitQueue()
+{
+    ScriptScheduler preinstall_scripts;
+    ScriptScheduler postinstall_scripts;
+    QStringList sequential_names;
     QString install_names;
 
-    // load all the
-    foreach (const QString name, name_list) {
+    if (queue.isEmpty()) {
+        return;
+    }
+    // the scripts and apt-get must not run while the prefetcher writes to the archive cache, it's started again
+    // below with the final set of packages
+    prefetch_timer->stop();
+    prefetcher->cancel();
+    if (queue.hasInstalls()) {
+        if (!connectivity->isOnline()) {
+            QMessageBox::critical(this, tr("Error"), tr("Internet is not available, won't be able to download the list of packages"));
+            return;
+        }
+        if (!updated_once) {
+            update();
+        }
+    }
+
+    // load all the scripts and package names, apps marked as order dependent are installed one by one
+    foreach (const QString &name, queue.apps()) {
         foreach (const QStringList &list, popular_apps) {
             if (list.at(1) == name) {
-                postinstall += list.at(6) + "\n";
-                install_names += list.at(7) + " ";
+                if (list.at(9) == "true") {
+                    sequential_names << name;
+                } else {
+                    QStringList after;
+                    foreach (const QString &app, list.at(10).split(QRegExp("[,\n]"), QString::SkipEmptyParts)) {
+                        after << app.trimmed();
+                    }
+                    bool exclusive = (list.at(11) == "true");
+                    preinstall_scripts.addScript(name, list.at(5), after, exclusive);
+                    postinstall_scripts.addScript(name, list.at(6), after, exclusive);
+                    install_names += list.at(7) + " ";
+                }
             }
         }
     }
-    setConnections();
 
-    if (install_names != "") {
-        progress->hide();
-        this->hide();
-        progress->setLabelText(tr("Installing..."));
-        install(install_names);
-        this->show();
+    runScripts(&preinstall_scripts, tr("Pre-processing..."));
+
+    // enable the sources needed by the queued packages
+    QStringList sources = queue.sources();
+    if (!sources.isEmpty()) {
+        QFile file("/etc/apt/sources.list.d/mxpm-temp.list");
+        if (!file.open(QFile::WriteOnly | QFile::Text)) {
+            qDebug() << "Could not open file: " << file.fileName();
+        } else {
+            QTextStream stream(&file);
+            stream << sources.join("\n") << "\n";
+            file.close();
+        }
+        update();
+    }
+
+    // let the prefetch finish so apt finds the packages in the cache
+    startPrefetch();
+    if (prefetcher->isRunning()) {
+        connect(prefetcher, &DebPrefetcher::progress, this, &MainWindow::prefetchProgress, Qt::UniqueConnection);
+        bar->setMaximum(100);
+        bar->setValue(0);
+        progress->setLabelText(tr("Downloading packages..."));
+        progCancel->setEnabled(true);
         progress->show();
+        prefetcher->waitForFinished();
+        progCancel->setDisabled(true);
     }
-    setConnections();
-    progress->setLabelText(tr("Post-processing..."));
+
+    bool success = true;
+    QString args = (install_names + queue.aptArgs()).trimmed();
+    if (!args.isEmpty()) {
+        lock_file->unlock();
+        success = runApt("install --reinstall " + args, tr("Applying changes..."));
+        lock_file->lock();
+    }
+
+    if (!sources.isEmpty()) {
+        QFile::remove("/etc/apt/sources.list.d/mxpm-temp.list");
+        update();
+    }
+    progress->hide();
+    if (!success) { // keep the queue so the user can retry or clear it
+        return;
+    }
+
+    runScripts(&postinstall_scripts, tr("Post-processing..."));
+
+    // install the rest of the apps
+    foreach (const QString &name, sequential_names) {
+        installPopularApp(name);
+    }
+
+    bool apps_installed = !queue.apps().isEmpty();
+    queue.clear();
+    updateQueueButton();
+    setCursor(QCursor(Qt::ArrowCursor));
+    if (apps_installed && QMessageBox::information(this, tr("Done"),
+                                                   tr("Process finished.<p><b>Do you want to exit MX Package Installer?</b>"),
+                                                   tr("Yes"), tr("No")) == 0){
+        qApp->exit(0);
+    }
+    refreshPopularApps();
+    clearCache();
+    if (ui->tabOtherRepos->isVisible()) {
+        buildPackageLists();
+    }
+}
+
+// Run pre/postinstall scripts, independent scripts run in parallel
+void MainWindow::runScripts(ScriptScheduler *scheduler, const QString &label)
+{
+    if (scheduler->isEmpty()) {
+        return;
+    }
+    connect(scheduler, &ScriptScheduler::progress, this, &MainWindow::scriptProgress);
+    connect(scheduler, &ScriptScheduler::scriptFinished, this, &MainWindow::scriptFinished);
+    script_label = label;
+    script_errors.clear();
+    bar->setMaximum(0);
+    progress->setLabelText(label);
+    progress->show();
+    setCursor(QCursor(Qt::BusyCursor));
     lock_file->unlock();
-    cmd->run(postinstall);
+    scheduler->run();
     lock_file->lock();
+    setCursor(QCursor(Qt::ArrowCursor));
     progress->hide();
+
+    if (!script_errors.isEmpty()) {
+        QMessageBox msgBox(QMessageBox::Warning, tr("Error"),
+                           tr("%1 script(s) failed, please check the details.").arg(script_errors.size()),
+                           QMessageBox::Close, this);
+        msgBox.setDetailedText(script_errors.join("\n\n"));
+        msgBox.exec();
+    }
 }
 
 // install named app
@@ -629,11 +919,7 @@ void MainWindow::installPopularApp(const QString &name)
     cmd->run(preinstall);
 
     if (install_names != "") {
-        progress->hide();
-        this->hide();
-        progress->setLabelText(tr("Installing ") + name);
         install(install_names);
-        this->show();
         progress->show();
     }
     setConnections();
@@ -645,112 +931,137 @@ void MainWindow::installPopularApp(const QString &name)
 }
 
 
-// Process checked items to install
-void MainWindow::installPopularApps()
+// Add the checked Popular Apps to the transaction queue
+void MainWindow::queuePopularApps()
 {
-    QStringList batch_names;
-
-    if (!checkOnline()) {
-        QMessageBox::critical(this, tr("Error"), tr("Internet is not available, won't be able to download the list of packages"));
-        return;
-    }
-    if (!updated_once) {
-        update();
-    }
-
-    // make a list of apps to be installed together
     QTreeWidgetItemIterator it(ui->treePopularApps);
     while (*it) {
         if ((*it)->checkState(1) == Qt::Checked) {
-            QString name = (*it)->text(2);
-            foreach (const QStringList &list, popular_apps) {
-                if (list.at(1) == name) {
-                    QString preinstall = list.at(5);
-                    if (preinstall == "") {  // add to batch processing if there is not preinstall command
-                        batch_names << name;
-                        (*it)->setCheckState(1, Qt::Unchecked);
-                    }
-                }
-            }
+            queue.addApp((*it)->text(2));
+            (*it)->setCheckState(1, Qt::Unchecked);
         }
         ++it;
     }
-    installBatch(batch_names);
+    on_treePopularApps_itemClicked();
+}
 
-    // install the rest of the apps
-    QTreeWidgetItemIterator iter(ui->treePopularApps);
-    while (*iter) {
-        if ((*iter)->checkState(1) == Qt::Checked) {
-            installPopularApp((*iter)->text(2));
+// Add packages of the current repo to the transaction queue, with its target release and the sources needed for installing
+void MainWindow::queuePackages(const QStringList &names)
+{
+    const Repo &repo = currentRepo();
+    if (repo.apt) {
+        queue.addInstall(names);
+    } else {
+        queue.addInstall(names, repo.release,
+                         QStringList("deb " + repoUri(repo, true) + " " + repo.dist + " " + repo.components.join(" ")));
+    }
+}
+
+// Add the items selected in ui->treeOther to the transaction queue
+void MainWindow::queueSelected()
+{
+    queuePackages(package_model->checkedNames());
+    uncheckOther();
+}
+
+// Show the queued changes and ask whether to apply them now, keep them for later, or drop them
+void MainWindow::reviewQueue()
+{
+    updateQueueButton();
+    prefetch_timer->start();
+    if (queue.isEmpty()) {
+        return;
+    }
+    QString details;
+    foreach (const QString &app, queue.apps()) {
+        details += tr("Install app: ") + app + "\n";
+    }
+    foreach (QString name, queue.aptArgs().split(" ", QString::SkipEmptyParts)) {
+        if (name.endsWith("-")) {
+            details += tr("Remove: ") + name.left(name.length() - 1) + "\n";
+        } else {
+            details += tr("Install: ") + name.left(name.length() - 1) + "\n";
         }
-        ++iter;
     }
-    setCursor(QCursor(Qt::ArrowCursor));
-    if (QMessageBox::information(this, tr("Done"),
-                                 tr("Process finished.<p><b>Do you want to exit MX Package Installer?</b>"),
-                                 tr("Yes"), tr("No")) == 0){
-        qApp->exit(0);
+    QMessageBox msgBox(QMessageBox::Question, tr("Pending changes"),
+                       tr("%1 changes are queued. Apply them now, or keep selecting packages and apply them later?").arg(queue.count()),
+                       QMessageBox::NoButton, this);
+    msgBox.setDetailedText(details);
+    QPushButton *apply_button = msgBox.addButton(tr("Apply now"), QMessageBox::AcceptRole);
+    QPushButton *clear_button = msgBox.addButton(tr("Clear queue"), QMessageBox::DestructiveRole);
+    msgBox.addButton(tr("Later"), QMessageBox::RejectRole);
+    msgBox.exec();
+    if (msgBox.clickedButton() == apply_button) {
+        commitQueue();
+    } else if (msgBox.clickedButton() == clear_button) {
+        queue.clear();
+        updateQueueButton();
     }
-    refreshPopularApps();
-    clearCache();
-    this->show();
 }
 
-// Install selected items from ui->treeOther
-void MainWindow::installSelected()
+// Uncheck all the packages in ui->treeOther
+void MainWindow::uncheckOther()
 {
-    QString names = change_list.join(" ");
+    package_model->uncheckAll();
+    ui->buttonInstall->setEnabled(false);
+    ui->buttonUninstall->setEnabled(false);
+}
 
-    // change sources as needed
-    if(ui->radioMXtest->isChecked()) {
-        cmd->run("echo deb http://main.mepis-deb.org/mx/testrepo/ mx15 test>>/etc/apt/sources.list.d/mxpm-temp.list");
-        //enable mx16 repo if necessary
-        if (system("cat /etc/apt/sources.list.d/*.list |grep -q mx16") == 0) {
-            cmd->run("echo deb http://main.mepis-deb.org/mx/testrepo/ mx16 test>>/etc/apt/sources.list.d/mxpm-temp.list");
+// Prefetch the .debs of the checked and queued packages while the user is still making the selection
+void MainWindow::startPrefetch()
+{
+    QStringList names = queue.defaultSourceInstalls();
+    QStringList apps = queue.apps();
+    QTreeWidgetItemIterator it(ui->treePopularApps);
+    while (*it) {
+        if ((*it)->checkState(1) == Qt::Checked) {
+            apps << (*it)->text(2);
         }
-        update();
-    } else if (ui->radioBackports->isChecked()) {
-        cmd->run("echo deb http://ftp.debian.org/debian jessie-backports main contrib non-free>/etc/apt/sources.list.d/mxpm-temp.list");
-        update();
+        ++it;
     }
-    progress->hide();
-    install(names);
-    if (ui->radioMXtest->isChecked() || ui->radioBackports->isChecked()) {
-        cmd->run("rm -f /etc/apt/sources.list.d/mxpm-temp.list");
-        update();
+    foreach (const QStringList &list, popular_apps) {
+        // apps with preinstall scripts might need sources that are not enabled yet
+        if (apps.contains(list.at(1)) && list.at(5).isEmpty()) {
+            names << list.at(7).split(" ", QString::SkipEmptyParts);
+        }
     }
-    change_list.clear();
-    clearCache();
-    buildPackageLists();
+    if (currentRepo().apt) {
+        names << package_model->checkedNames();
+    }
+    names.removeDuplicates();
+    names.sort();
+    prefetcher->prefetch(names.join(" "));
 }
 
-// Check if online
-bool MainWindow::checkOnline()
+// Show the number of queued changes on the Apply button
+void MainWindow::updateQueueButton()
 {
-    return(system("wget -q --spider http://google.com >/dev/null 2>&1") == 0);
+    ui->buttonApply->setText(tr("Apply (%1)").arg(queue.count()));
+    ui->buttonApply->setVisible(!queue.isEmpty());
 }
 
 // Build the list of available packages from various source
 bool MainWindow::buildPackageLists(bool force_download)
 {
     clearUi();
-    ui->treeOther->blockSignals(true);
-    if (!downloadPackageList(force_download)) {
-        ifDownloadFailed();
-        return false;
-    }
-    if (!readPackageList(force_download)) {
+    startLoading();
+    // a cached store has all it needs, the lists are downloaded (or revalidated) and parsed again only when it was dropped
+    bool ok = (stores.contains(currentRepo().id) && !force_download) ||
+            (downloadPackageList(force_download) && readPackageList(force_download));
+    if (ok) {
+        displayPackages(force_download);
+    }
+    stopLoading();
+    if (!ok) {
         ifDownloadFailed();
-        return false;
     }
-    displayPackages(force_download);
-    return true;
+    return ok;
 }
 
 // Download the Packages.gz from sources
 bool MainWindow::downloadPackageList(bool force_download)
 {
-    if (!checkOnline()) {
+    if (!connectivity->isOnline()) {
         QMessageBox::critical(this, tr("Error"), tr("Internet is not available, won't be able to download the list of packages"));
         return false;
     }
@@ -761,115 +1072,78 @@ bool MainWindow::downloadPackageList(bool force_download)
     setConnections();
     progress->setLabelText(tr("Downloading package info..."));
     progCancel->setEnabled(true);
-    if (ui->radioStable->isChecked()) {
-        if (stable_raw.isEmpty() || force_download) {
-            if (force_download) {
-                if (!update()) {
-                    return false;
-                }
-            }
-            progress->show();
-            if (cmd->run("LC_ALL=en_US.UTF-8 apt-cache dumpavail") == 0) {
-                stable_raw = cmd->getOutput();
-            } else {
+    const Repo &repo = currentRepo();
+    if (repo.apt) {
+        if (force_download) {
+            if (!update()) {
                 return false;
             }
         }
-    } else if (ui->radioMXtest->isChecked())  {
-        if (!QFile(tmp_dir + "/mx15Packages").exists() || force_download) {
-            progress->show();
-            if (cmd->run("wget http://mxrepo.com/mx/testrepo/dists/mx15/test/binary-" + arch +
-                             "/Packages.gz -O mx15Packages.gz && gzip -df mx15Packages.gz") != 0) {
-                QFile::remove(tmp_dir + "/mx15Packages.gz");
-                QFile::remove(tmp_dir + "/mx15Packages");
-                return false;
-            }
+        progress->show();
+        if (cmd->run("LC_ALL=en_US.UTF-8 apt-cache dumpavail") != 0) {
+            return false;
         }
+        stable_raw = cmd->getOutput();
     } else {
-        if (!QFile(tmp_dir + "/mainPackages").exists() ||
-                !QFile(tmp_dir + "/contribPackages").exists() ||
-                !QFile(tmp_dir + "/nonfreePackages").exists() || force_download) {
-            progress->show();
-            int err = cmd->run("wget ftp://ftp.us.debian.org/debian/dists/jessie-backports/main/binary-" + arch +
-                                "/Packages.gz -O mainPackages.gz && gzip -df mainPackages.gz");
-            if (err != 0 ) {
-                QFile::remove(tmp_dir + "/mainPackages.gz");
-                QFile::remove(tmp_dir + "/mainPackages");
-                return false;
-            }
-            err = cmd->run("wget ftp://ftp.us.debian.org/debian/dists/jessie-backports/contrib/binary-" + arch +
-                                "/Packages.gz -O contribPackages.gz && gzip -df contribPackages.gz");
-            if (err != 0 ) {
-                QFile::remove(tmp_dir + "/contribPackages.gz");
-                QFile::remove(tmp_dir + "/contribPackages");
-                return false;
-            }
-            err = cmd->run("wget ftp://ftp.us.debian.org/debian/dists/jessie-backports/non-free/binary-" + arch +
-                                "/Packages.gz -O nonfreePackages.gz && gzip -df nonfreePackages.gz");
-            if (err != 0 ) {
-                QFile::remove(tmp_dir + "/nonfreePackages.gz");
-                QFile::remove(tmp_dir + "/nonfreePackages");
-                return false;
-            }
-            progCancel->setDisabled(true);
-            cmd->run("cat mainPackages + contribPackages + nonfreePackages > allPackages");
+        progress->show();
+        // download all the components at the same time
+        QStringList targets;
+        foreach (const QString &component, repo.components) {
+            targets << component + "/binary-" + arch + "/Packages";
+        }
+        bool ok;
+        do {
+            ok = downloader->download(repoUri(repo) + "dists/" + repo.dist, targets);
+        } while (!ok && retryAfterTimeout(downloader->watchdog(), tr("Downloading the package info did not complete.")));
+        progCancel->setDisabled(true);
+        if (!ok) {
+            return false;
         }
+        // the index is parsed while downloading, files the server said didn't change are read from the index cache
+        package_lists[repo.id] = downloader->packages();
     }
     return true;
 }
 
-// Process downloaded *Packages.gz files
-bool MainWindow::readPackageList(bool force_download)
+// Show the progress of each index download, and the packages parsed so far when there are enough new ones
+void MainWindow::indexProgress()
 {
-    QFile file;
-    QMap<QString, QStringList> map;
-    QStringList list;
-    QStringList package_list;
-    QStringList version_list;
-    QStringList description_list;
-
-    progCancel->setDisabled(true);
-    // don't process if the lists are populate
-    if (!(stable_list.isEmpty() || mx_list.isEmpty() || backports_list.isEmpty() || force_download)) {
-        return true;
-    }
-    if (ui->radioStable->isChecked()) { // read Stable list
-        list = stable_raw.split("\n");
-    } else {
-         progress->show();
-         progress->setLabelText(tr("Reading downloaded file..."));
-         if (ui->radioMXtest->isChecked())  { // read MX Test list
-             file.setFileName(tmp_dir + "/mx15Packages");
-         } else if (ui->radioBackports->isChecked()) {  // read Backports lsit
-             file.setFileName(tmp_dir + "/allPackages");
-         }
-         if(!file.open(QFile::ReadOnly)) {
-             qDebug() << "Count not open file: " << file.fileName();
-             return false;
-         }
-         QString file_content = file.readAll();
-         list = file_content.split("\n");
-         file.close();
-    }
-    foreach(QString line, list) {
-        if (line.startsWith("Package: ")) {
-            package_list << line.remove("Package: ");
-        } else if (line.startsWith("Version: ")) {
-            version_list << line.remove("Version: ");
-        } else if (line.startsWith("Description: ")) {
-            description_list << line.remove("Description: ");
+    qint64 received = 0;
+    qint64 total = 0;
+    QString text = tr("Downloading package info...");
+    for (int i = 0; i < downloader->count(); ++i) {
+        received += downloader->received(i);
+        total += downloader->total(i);
+        if (downloader->total(i) > 0) {
+            text += "\n" + downloader->name(i) + ": " + QString::number(downloader->received(i) * 100 / downloader->total(i)) + "%";
         }
     }
-    for (int i = 0; i < package_list.size(); ++i) {
-        map.insert(package_list.at(i), QStringList() << version_list.at(i) << description_list.at(i));
+    int percent = total > 0 ? received * 100 / total : 0;
+    if (loading && downloader->parsedCount() >= (published_count > 0 ? 2 * published_count : first_batch)) {
+        publishPackages(PackageSnapshot(new PackageStore(downloader->parsedPackages(), QHash<QString, VersionNumber>(),
+                                                         QHash<QString, VersionNumber>(), 0)));
     }
-    if (ui->radioStable->isChecked()) {
-        stable_list = map;
-    } else if (ui->radioMXtest->isChecked())  {
-        mx_list = map;
-    } else if (ui->radioBackports->isChecked()) {
-        backports_list = map;
+    if (!showLoadProgress(tr("Downloading package info..."), percent)) {
+        progress->setLabelText(text);
+        bar->setMaximum(100);
+        bar->setValue(percent);
     }
+}
+
+// Process the package list, the lists of downloaded repos are already parsed while downloading
+bool MainWindow::readPackageList(bool force_download)
+{
+    Q_UNUSED(force_download);
+    progCancel->setDisabled(true);
+    const Repo &repo = currentRepo();
+    if (!repo.apt) {
+        return true; // parsed while downloading
+    }
+    PackagesParser parser;
+    parser.feed(stable_raw.toUtf8());
+    parser.finish();
+    stable_raw.clear(); // dumped again if the store gets dropped
+    package_lists[repo.id] = parser.packages();
     return true;
 }
 
@@ -877,6 +1151,11 @@ bool MainWindow::readPackageList(bool force_download)
 void MainWindow::cancelDownload()
 {
     qDebug() << "cancel download";
+    prefetcher->cancel();
+    downloader->cancel();
+    foreach (MirrorSelector *selector, mirrors) {
+        selector->cancel(); // the previous choice or the first candidate is used
+    }
     cmd->terminate();
 }
 
@@ -898,28 +1177,14 @@ void MainWindow::clearUi()
     ui->buttonForceUpdate->setEnabled(false);
 
     ui->searchBox->clear();
-    ui->treeOther->clear();
-}
-
-// Copy QTreeWidgets
-void MainWindow::copyTree(QTreeWidget *from, QTreeWidget *to)
-{
-
-    to->clear();
-    QTreeWidgetItem *item;
-    QTreeWidgetItemIterator it(from);
-    while (*it) {
-        item = new QTreeWidgetItem();
-        item = (*it)->clone();
-        to->addTopLevelItem(item);
-        ++it;
-    }
+    package_model->clear();
 }
 
 // Cleanup environment when window is closed
 void MainWindow::cleanup()
 {
     qDebug() << "cleanup code";
+    prefetcher->cancel();
     if(!cmd->terminate()) {
         cmd->kill();
     }
@@ -932,12 +1197,10 @@ void MainWindow::cleanup()
     }
 }
 
-// Clear cached trees
+// Clear cached package stores
 void MainWindow::clearCache()
 {
-    tree_stable->clear();
-    tree_mx_test->clear();
-    tree_backports->clear();
+    stores.clear();
     app_info_list.clear();
     if (!QFile::remove(tmp_dir + "/listapps")) {
         qDebug() << "could not remove listapps file";
@@ -951,54 +1214,54 @@ QString MainWindow::getVersion(QString name)
     return cmd->getOutput("dpkg -l "+ name + "| awk 'NR==6 {print $3}'");
 }
 
-// Return true if all the packages listed are installed
-bool MainWindow::checkInstalled(const QString &names)
+// Return the repo selected in the Full App Catalog
+const Repo &MainWindow::currentRepo()
 {
-    if (names == "") {
-        return false;
-    }
-    foreach(const QString &name, names.split("\n")) {
-        if (!installed_packages.contains(name)) {
-            return false;
-        }
-    }
-    return true;
+    return repos.at(qMax(0, ui->comboRepo->currentIndex()));
 }
 
-// Return true if all the packages in the list are installed
-bool MainWindow::checkInstalled(const QStringList &name_list)
+// Return the base URI of the repo, the fastest mirror if it has any.
+// Probing the mirrors takes a few seconds, it's shown in the progress dialog and can be cancelled
+QString MainWindow::repoUri(const Repo &repo, bool for_install)
 {
-    if (name_list.size() == 0) {
-        return false;
-    }
-    foreach(const QString &name, name_list) {
-        if (!installed_packages.contains(name)) {
-            return false;
-        }
+    if (!mirrors.contains(repo.id)) {
+        return for_install ? repo.source_uri : repo.uri;
+    }
+    MirrorSelector *selector = mirrors.value(repo.id);
+    QString probe_path = "dists/" + repo.dist + "/Release";
+    if (selector->isCached()) {
+        return selector->mirror(probe_path);
+    }
+    QString label = progress->labelText();
+    bool visible = progress->isVisible();
+    bool cancel_enabled = progCancel->isEnabled();
+    progress->setLabelText(tr("Finding the fastest mirror..."));
+    bar->setMaximum(0);
+    progCancel->setEnabled(true);
+    progress->show();
+    QString uri = selector->mirror(probe_path);
+    progress->setLabelText(label);
+    progCancel->setEnabled(cancel_enabled);
+    if (!visible) {
+        progress->hide();
     }
-    return true;
+    return uri;
 }
 
-// return true if all the items in the list are upgradable
-bool MainWindow::checkUpgradable(const QStringList &name_list)
+// Return true if all the packages listed are installed
+bool MainWindow::checkInstalled(const QString &names)
 {
-    if (name_list.size() == 0) {
+    if (names == "") {
         return false;
     }
-    QList<QTreeWidgetItem *> item_list;
-    foreach(const QString &name, name_list) {
-        item_list = ui->treeOther->findItems(name, Qt::MatchExactly, 2);
-        if (item_list.isEmpty()) {
-            return false;
-        }
-        if (item_list.at(0)->text(5) != "upgradable") {
+    foreach(const QString &name, names.split("\n")) {
+        if (!installed_packages.contains(name)) {
             return false;
         }
     }
     return true;
 }
 
-
 // Returns list of all installed packages
 QStringList MainWindow::listInstalled()
 {
@@ -1049,12 +1312,16 @@ void MainWindow::displayInfo(QTreeWidgetItem *item, int column)
 
             QEventLoop loop;
             connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-            timer->start(5000);
-            connect(timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+            connect(reply, &QNetworkReply::downloadProgress, screenshot_limit, &Watchdog::kick);
+            connect(screenshot_limit, &Watchdog::expired, &loop, &QEventLoop::quit);
+            screenshot_limit->start();
             ui->treePopularApps->blockSignals(true);
             loop.exec();
-            timer->stop();
+            screenshot_limit->stop();
             ui->treePopularApps->blockSignals(false);
+            if (!reply->isFinished()) { // timed out
+                reply->abort();
+            }
 
             if (reply->error())
             {
@@ -1082,6 +1349,7 @@ void MainWindow::displayInfo(QTreeWidgetItem *item, int column)
 // Find package in view
 void MainWindow::findPackage()
 {
+    popular_search_timer->stop();
     QTreeWidgetItemIterator it(ui->treePopularApps);
     QString word = ui->searchPopular->text();
     if (word == "") {
@@ -1096,11 +1364,12 @@ void MainWindow::findPackage()
         return;
     }
     QList<QTreeWidgetItem *> found_items = ui->treePopularApps->findItems(word, Qt::MatchContains|Qt::MatchRecursive, 2);
+    QSet<QTreeWidgetItem *> found_set = found_items.toSet();
 
     // hide/unhide items
     while (*it) {
         if ((*it)->childCount() == 0) { // if child
-            if (found_items.contains(*it)) {
+            if (found_set.contains(*it)) {
                 (*it)->setHidden(false);
           } else {
                 (*it)->parent()->setHidden(true);
@@ -1129,24 +1398,90 @@ void MainWindow::findPackage()
     }
 }
 
-// Find packages in the second tab (other sources)
+// Show the packages that pass the status and library filters, combining the bitsets of the store a word
+// (64 packages) at a time, and the query typed in the search box. The query runs on a pool thread and
+// replaces the one still running, if any; the rows of a query that checks the packages one by one arrive in batches
 void MainWindow::findPackageOther()
 {
-    QString word = ui->searchBox->text();
-    QList<QTreeWidgetItem *> found_items = ui->treeOther->findItems(word, Qt::MatchContains, 2);
-    QTreeWidgetItemIterator it(ui->treeOther);
-    while (*it) {
-      if ((*it)->text(6) == "true" && found_items.contains(*it)) {
-          (*it)->setHidden(false);
-      } else {
-          (*it)->setHidden(true);
-      }
-      // hide libs
-      QString app_name = (*it)->text(2);
-      if (((app_name.startsWith("lib") && !app_name.startsWith("libreoffice")) || app_name.endsWith("-dev")) && ui->checkHideLibs->isChecked()) {
-          (*it)->setHidden(true);
-      }
-      ++it;
+    search_timer->stop();
+    const PackageStore &store = package_model->store();
+    Bitset visible(store.size(), true);
+    QString filter = ui->comboFilter->currentText();
+    if (filter == tr("Upgradable")) {
+        visible &= store.statusBits(PackageStore::Upgradable);
+    } else if (filter == tr("Installed")) {
+        visible &= store.statusBits(PackageStore::Installed);
+    } else if (filter == tr("Not installed")) {
+        visible &= store.statusBits(PackageStore::NotInstalled);
+    }
+    if (ui->checkHideLibs->isChecked()) {
+        visible &= ~store.libraryBits();
+    }
+    search_hint->hide();
+    QString error = query_runner->start(package_model->snapshot(), ui->searchBox->text(), visible, search_limit);
+    ui->searchBox->setToolTip(error.isEmpty() ? search_help : error);
+    ui->searchBox->setStyleSheet(error.isEmpty() ? QString() : "color: red");
+}
+
+// The position kept for the rows of this query is not looked for in later ones
+void MainWindow::queryFinished()
+{
+    keep_current.clear();
+    keep_top.clear();
+}
+
+// Only the best matches of the search are shown, say how many there are in total
+void MainWindow::queryLimited(int shown, int total)
+{
+    if (query_runner->snapshot() != package_model->snapshot()) {
+        return;
+    }
+    search_hint->setText(tr("Showing the best %1 of %2 matches").arg(shown).arg(total));
+    search_hint->setToolTip(tr("The limit can be changed with max_results in /etc/mx-package-manager.conf."));
+    search_hint->show();
+}
+
+// Show the rows found by the query
+void MainWindow::queryRows(const QVector<int> &rows, bool replace)
+{
+    if (query_runner->snapshot() != package_model->snapshot()) {
+        return; // rows of the store shown before, the new one gets its own query
+    }
+    if (replace) {
+        package_model->setRows(rows);
+    } else {
+        package_model->appendRows(rows);
+    }
+    restoreViewPosition();
+}
+
+// Remember the current package and the one at the top of the list, a newer store of the list is about to be shown.
+// A position that wasn't restored yet is kept, the rows shown meanwhile are not where the user left the list
+void MainWindow::keepViewPosition()
+{
+    QModelIndex current = ui->treeOther->currentIndex();
+    QModelIndex top = ui->treeOther->indexAt(QPoint(0, 0));
+    if (keep_current.isEmpty()) {
+        keep_current = current.sibling(current.row(), PackageModel::NameColumn).data().toString();
+    }
+    if (keep_top.isEmpty()) {
+        keep_top = top.sibling(top.row(), PackageModel::NameColumn).data().toString();
+    }
+}
+
+// Scroll back to the package that was at the top and make the one that was current again, once their rows are shown
+void MainWindow::restoreViewPosition()
+{
+    int row = keep_top.isEmpty() ? -1 : package_model->rowOf(keep_top);
+    if (row != -1) {
+        ui->treeOther->scrollTo(package_model->index(row, PackageModel::NameColumn), QAbstractItemView::PositionAtTop);
+        keep_top.clear();
+    }
+    row = keep_current.isEmpty() ? -1 : package_model->rowOf(keep_current);
+    if (row != -1) {
+        ui->treeOther->selectionModel()->setCurrentIndex(package_model->index(row, PackageModel::NameColumn),
+                                                         QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+        keep_current.clear();
     }
 }
 
@@ -1154,10 +1489,17 @@ void MainWindow::findPackageOther()
 void MainWindow::on_buttonInstall_clicked()
 {
     if (ui->tabApps->isVisible()) {
-        installPopularApps();
+        queuePopularApps();
     } else {
-        installSelected();
+        queueSelected();
     }
+    reviewQueue();
+}
+
+// Apply button clicked
+void MainWindow::on_buttonApply_clicked()
+{
+    reviewQueue();
 }
 
 // About button clicked
@@ -1211,6 +1553,7 @@ void MainWindow::on_treePopularApps_itemClicked()
     }
     ui->buttonInstall->setEnabled(checked);
     ui->buttonUninstall->setEnabled(checked && installed);
+    prefetch_timer->start();
     if (checked && installed) {
         ui->buttonInstall->setText(tr("Reinstall"));
     } else {
@@ -1238,58 +1581,47 @@ void MainWindow::on_treePopularApps_itemCollapsed(QTreeWidgetItem *item)
 // Uninstall clicked
 void MainWindow::on_buttonUninstall_clicked()
 {
-    QString names;
+    QStringList names;
     if (ui->tabApps->isVisible()) {
         QTreeWidgetItemIterator it(ui->treePopularApps);
         while (*it) {
             if ((*it)->checkState(1) == Qt::Checked) {
-                names += (*it)->text(6).replace("\n", " ") + " ";
+                names << (*it)->text(6).split(QRegExp("\\s+"), QString::SkipEmptyParts);
+                (*it)->setCheckState(1, Qt::Unchecked);
             }
             ++it;
         }
+        on_treePopularApps_itemClicked();
     } else if (ui->tabOtherRepos->isVisible()) {
-        names = change_list.join(" ");
+        names = package_model->checkedNames();
+        uncheckOther();
     }
-    uninstall(names);
+    qDebug() << "uninstall list: " << names;
+    queue.addRemove(names);
+    reviewQueue();
 }
 
 // Actions on switching the tabs
 void MainWindow::on_tabWidget_currentChanged(int index)
 {
     if (index == 1) {
-        // show select message if the current tree is not cached
-        if ((ui->radioStable->isChecked() && tree_stable->topLevelItemCount() == 0 ) ||
-            (ui->radioMXtest->isChecked() && tree_mx_test->topLevelItemCount() == 0 ) ||
-                    (ui->radioBackports->isChecked() && tree_backports->topLevelItemCount() == 0))
-        {
+        // show select message if the packages of the current repo are not loaded yet
+        if (!repo_stats.contains(currentRepo().id)) {
             QMessageBox msgBox(QMessageBox::Question,
                                tr("Repo Selection"),
                                tr("Plese select repo to load"));
-            msgBox.addButton(tr("Debian Backports Repo"), QMessageBox::AcceptRole);
-            msgBox.addButton(tr("MX Test Repo"), QMessageBox::AcceptRole);
-            msgBox.addButton(tr("Stable Repo"), QMessageBox::AcceptRole);
+            foreach (const Repo &repo, repos) {
+                msgBox.addButton(repo.name, QMessageBox::AcceptRole);
+            }
             msgBox.addButton(tr("Cancel"), QMessageBox::NoRole);
             int ret = msgBox.exec();
-            switch (ret) {
-            case 0:
-                ui->radioBackports->blockSignals(true);
-                ui->radioBackports->setChecked(true);
-                ui->radioBackports->blockSignals(false);
-                break;
-            case 1:
-                ui->radioMXtest->blockSignals(true);
-                ui->radioMXtest->setChecked(true);
-                ui->radioMXtest->blockSignals(false);
-                break;
-            case 2:
-                ui->radioStable->blockSignals(true);
-                ui->radioStable->setChecked(true);
-                ui->radioStable->blockSignals(false);
-                break;
-            default:
+            if (ret < 0 || ret >= repos.size()) {
                 ui->tabWidget->setCurrentIndex(0);
                 return;
             }
+            ui->comboRepo->blockSignals(true);
+            ui->comboRepo->setCurrentIndex(ret);
+            ui->comboRepo->blockSignals(false);
         }
         buildPackageLists();
     } if (index == 0) {
@@ -1303,98 +1635,45 @@ void MainWindow::on_tabWidget_currentChanged(int index)
 // Filter items according to selected filter
 void MainWindow::on_comboFilter_activated(const QString &arg1)
 {
-    QList<QTreeWidgetItem *> found_items;
-    QTreeWidgetItemIterator it(ui->treeOther);
-    ui->treeOther->blockSignals(true);
-
-    if (arg1 == tr("All packages")) {
-        while (*it) {
-            (*it)->setText(6, "true"); // Displayed flag
-            (*it)->setHidden(false);
-            ++it;
-        }
-        findPackageOther();
-        ui->treeOther->blockSignals(false);
-        return;
-    }
-
-    if (arg1 == tr("Upgradable")) {
-        found_items = ui->treeOther->findItems("upgradable", Qt::MatchExactly, 5);
-    } else if (arg1 == tr("Installed")) {
-        found_items = ui->treeOther->findItems("installed", Qt::MatchExactly, 5);
-    } else if (arg1 == tr("Not installed")) {
-        found_items = ui->treeOther->findItems("not installed", Qt::MatchExactly, 5);
-    }
-
-    while (*it) {
-        if (found_items.contains(*it) ) {
-            (*it)->setHidden(false);
-            (*it)->setText(6, "true"); // Displayed flag
-        } else {
-            (*it)->setHidden(true);
-            (*it)->setText(6, "false");
-        }
-        ++it;
-    }
+    Q_UNUSED(arg1);
     findPackageOther();
-    ui->treeOther->blockSignals(false);
 }
 
-// When selecting on item in the list
-void MainWindow::on_treeOther_itemChanged(QTreeWidgetItem *item)
+// When a package is checked or unchecked in the list
+void MainWindow::packageChecked(const QString &name, bool checked)
+{
+    Q_UNUSED(name);
+    Q_UNUSED(checked);
+    updateSelectionButtons();
+    prefetch_timer->start();
+}
+
+// Set the Install/Upgrade and Uninstall buttons from the counts of checked packages kept by the model
+void MainWindow::updateSelectionButtons()
 {
     /* if all apps are uninstalled (or some installed) -> enable Install, disable Uinstall
      * if all apps are installed or upgradable -> enable Uninstall, enable Install
      * if all apps are upgradable -> change Install label to Upgrade;
+     * nothing can be installed or removed while the list is loading
      */
-
-    QString newapp = QString(item->text(2));
-    if (item->checkState(0) == Qt::Checked) {
-        ui->buttonInstall->setEnabled(true);
-        change_list.append(newapp);
-    } else {
-        change_list.removeOne(newapp);
-    }
-
-    if (!checkInstalled(change_list)) {
-        ui->buttonUninstall->setEnabled(false);
-    } else {
-        ui->buttonUninstall->setEnabled(true);
-    }
-
-    if (checkUpgradable(change_list)) {
+    int total = loading ? 0 : package_model->checkedCount();
+    ui->buttonInstall->setEnabled(total > 0);
+    ui->buttonUninstall->setEnabled(total > 0 && package_model->checkedCount(PackageStore::NotInstalled) == 0);
+    if (total > 0 && package_model->checkedCount(PackageStore::Upgradable) == total) {
         ui->buttonInstall->setText(tr("Upgrade"));
     } else {
         ui->buttonInstall->setText(tr("Install"));
     }
-
-    if (change_list.isEmpty()) {
-        ui->buttonInstall->setEnabled(false);
-        ui->buttonUninstall->setEnabled(false);
-    }
 }
 
 
-void MainWindow::on_radioStable_toggled(bool checked)
+// Switch to the selected repo
+void MainWindow::on_comboRepo_activated(int index)
 {
-    if(checked) {
-        buildPackageLists();
-    }
-}
-
-void MainWindow::on_radioMXtest_toggled(bool checked)
-{
-    if(checked) {
-        buildPackageLists();
-    }
-}
-
-void MainWindow::on_radioBackports_toggled(bool checked)
-{
-    if(checked) {
+    if (repos.at(index).warning) {
         displayWarning();
-        buildPackageLists();
     }
+    buildPackageLists();
 }
 
 // Force repo upgrade
@@ -1406,36 +1685,20 @@ void MainWindow::on_buttonForceUpdate_clicked()
 // Hide/unhide lib/-dev packages
 void MainWindow::on_checkHideLibs_clicked(bool checked)
 {
-    QTreeWidgetItemIterator it(ui->treeOther);
-    while (*it) {
-        QString app_name = (*it)->text(2);
-        if (((app_name.startsWith("lib") && !app_name.startsWith("libreoffice")) || app_name.endsWith("-dev")) && checked) {
-            (*it)->setHidden(true);
-        } else {
-            (*it)->setHidden(false);
-        }
-        ++it;
-    }
-    on_comboFilter_activated(ui->comboFilter->currentText());
+    Q_UNUSED(checked);
+    findPackageOther();
 }
 
 // Upgrade all packages (from Stable repo only)
 void MainWindow::on_buttonUpgradeAll_clicked()
 {
-    QString names;
-    QTreeWidgetItemIterator it(ui->treeOther);
-    QList<QTreeWidgetItem *> found_items;
-    found_items = ui->treeOther->findItems("upgradable", Qt::MatchExactly, 5);
-
-    while (*it) {
-        if(found_items.contains(*it)) {
-            names += (*it)->text(2) + " ";
-        }
-        ++it;
+    QStringList names;
+    const PackageStore &store = package_model->store();
+    foreach (int i, store.statusBits(PackageStore::Upgradable).indexes()) {
+        names << store.name(i);
     }
     qDebug() << "upgrading pacakges: " << names;
 
-    install(names);
-    clearCache();
-    buildPackageLists();
+    queuePackages(names);
+    reviewQueue();
 }
@@ -27,6 +27,7 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QCache>
 #include <QMessageBox>
 #include <QProcess>
 #include <QTimer>
@@ -36,8 +37,21 @@
 #include <QProgressDialog>
 #include <QTreeWidgetItem>
 
+#include <aptrunner.h>
 #include <cmd.h>
+#include <connectivitymonitor.h>
+#include <debprefetcher.h>
+#include <fetchscheduler.h>
+#include <indexdownloader.h>
 #include <lockfile.h>
+#include <mirrorselector.h>
+#include <packagemodel.h>
+#include <packagesparser.h>
+#include <queryrunner.h>
+#include <repoconfig.h>
+#include <scriptscheduler.h>
+#include <transactionqueue.h>
+#include <watchdog.h>
 
 
 namespace Ui {
@@ -55,54 +69,81 @@ public:
     QString version;
 
     bool checkInstalled(const QString &names);
-    bool checkInstalled(const QStringList &name_list);
-    bool checkUpgradable(const QStringList &name_list);
-    bool checkOnline();
     bool buildPackageLists(bool force_download = false);
     bool downloadPackageList(bool force_download = false);
     bool readPackageList(bool force_download = false);
+    bool retryAfterTimeout(const Watchdog *watchdog, const QString &text);
+    bool runApt(const QString &args, const QString &title);
+    bool showLoadProgress(const QString &text, int percent);
+    void runScripts(ScriptScheduler *scheduler, const QString &label);
 
     void cancelDownload();
     void clearUi();
-    void copyTree(QTreeWidget *, QTreeWidget *);
+    void commitQueue();
     void displayPopularApps();
     void displayPackages(bool force_refresh = false);
     void displayWarning();
     void downloadImage(const QUrl &url);
     void ifDownloadFailed();
     void install(const QString &names);
-    void installBatch(const QStringList &name_list);
-    void installPopularApp(const QString &name);    
-    void installPopularApps();
-    void installSelected();
+    void installPopularApp(const QString &name);
+    void keepViewPosition();
     void loadPmFiles();
     void processDoc(const QDomDocument &doc);
+    void publishPackages(const PackageSnapshot &store);
+    void queuePackages(const QStringList &names);
+    void queuePopularApps();
+    void queueSelected();
+    void readPolicy(const QStringList &items, QHash<QString, VersionNumber> *installed, QHash<QString, VersionNumber> *candidates);
     void refreshPopularApps();
+    void rejectScriptCycles();
+    void restoreViewPosition();
+    void reviewQueue();
     void setProgressDialog();
+    void setProxy();
     void setup();
-    void uninstall(const QString &names);
+    void showRepoStats();
+    void showStats(const PackageStats &stats);
+    void startLoading();
+    void stopLoading();
+    void uncheckOther();
     bool update();
     void updateInterface();
+    void updateQueueButton();
+    void updateSelectionButtons();
 
+    const Repo &currentRepo();
     QString getVersion(QString name);
+    QString repoUri(const Repo &repo, bool for_install = false);
     QString writeTmpFile(QString apps);
     QStringList listInstalled();
 
 public slots:
 
 private slots:
+    void aptProgress(int percent, const QString &message);
     void cleanup();
     void clearCache();
+    void scriptFinished(const QString &name, int exit_code, qint64 time, const QString &output);
+    void scriptProgress(int done, int total);
     void cmdStart();
     void cmdDone();
     void disableWarning(bool checked);
+    void prefetchProgress(qint64 received, qint64 total);
     void displayInfo(QTreeWidgetItem* item, int column);
     void findPackage();
     void findPackageOther();
+    void packageChecked(const QString &name, bool checked);
+    void queryFinished();
+    void queryLimited(int shown, int total);
+    void queryRows(const QVector<int> &rows, bool replace);
+    void indexProgress();
     void setConnections();
+    void startPrefetch();
     void tock(int, int); // tick-tock, updates progressBar when tick signal is emited
 
     void on_buttonInstall_clicked();
+    void on_buttonApply_clicked();
     void on_buttonAbout_clicked();
     void on_buttonHelp_clicked();
     void on_treePopularApps_expanded();
@@ -112,37 +153,57 @@ private slots:
     void on_buttonUninstall_clicked();
     void on_tabWidget_currentChanged(int index);
     void on_comboFilter_activated(const QString &arg1);
-    void on_treeOther_itemChanged(QTreeWidgetItem *item);
-    void on_radioStable_toggled(bool checked);
-    void on_radioMXtest_toggled(bool checked);
-    void on_radioBackports_toggled(bool checked);
+    void on_comboRepo_activated(int index);
     void on_buttonForceUpdate_clicked();
     void on_checkHideLibs_clicked(bool checked);
     void on_buttonUpgradeAll_clicked();
 
 private:
+    static const int first_batch = 1000; // packages shown first while a list is loading
+
+    bool loading; // rows are shown as soon as they are parsed
     bool updated_once;
     bool warning_displayed;
     int height_app;
+    int published_count; // packages shown so far while loading
+    int search_limit; // most search results shown
+    AptRunner *apt;
     Cmd *cmd;
+    ConnectivityMonitor *connectivity;
+    DebPrefetcher *prefetcher;
+    FetchScheduler *scheduler;
+    IndexDownloader *downloader;
     LockFile *lock_file;
+    PackageModel *package_model;
+    QPushButton *loading_cancel; // next to loading_bar, does what progCancel does while the dialog is hidden
     QPushButton *progCancel;
+    QueryRunner *query_runner;
     QList<QStringList> popular_apps;
+    QList<Repo> repos;
+    QMap<QString, MirrorSelector *> mirrors; // repo id -> mirror selector, for repos with mirrors
+    QMap<QString, QMap<QString, QStringList> > package_lists; // repo id -> (name -> version, description, section, size), until its store is built
+    QCache<QString, PackageSnapshot> stores; // repo id -> packages with their status, limited by memory used
+    QHash<QString, PackageStats> repo_stats; // repo id -> package counts, kept when the store is dropped
+    QLabel *search_hint; // tells when the search shows only the best matches
     QProgressBar *bar;
+    QProgressBar *loading_bar; // under the list, once rows are shown while loading
     QProgressDialog *progress;
     QString arch;
+    QString keep_current; // package made current again once the rows of a newer store are shown while loading
+    QString keep_top; // package scrolled back to the top then
+    QString script_label; // progress dialog label while scripts run
+    QString search_help; // tooltip of the search box
     QString stable_raw;
     QString tmp_dir;
     QStringList app_info_list;
     QStringList installed_packages;
-    QStringList change_list;
-    QMap<QString, QStringList> backports_list;
-    QMap<QString, QStringList> mx_list;
-    QMap<QString, QStringList> stable_list;
-    QTimer *timer;
-    QTreeWidget *tree_stable;
-    QTreeWidget *tree_mx_test;
-    QTreeWidget *tree_backports;
+    QStringList script_errors; // output of the scripts that failed in the last run
+    QTimer *popular_search_timer; // waits for a pause in typing before searching
+    QTimer *prefetch_timer;
+    QTimer *search_timer;
+    TransactionQueue queue;
+    Watchdog *screenshot_limit;
+    Watchdog *update_limit;
     Ui::MainWindow *ui;
 };
 
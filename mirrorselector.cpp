@@ -0,0 +1,195 @@
+/**********************************************************************
+ *  mirrorselector.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "mirrorselector.h"
+
+#include <QDateTime>
+
+#include <QDebug>
+
+const qint64 probe_size = 64 * 1024; // bytes read from each mirror
+const qint64 reference_size = 1024 * 1024; // mirrors are ranked by the estimated time to get this much
+
+MirrorSelector::MirrorSelector(const QString &name, const QStringList &mirror_list, QObject *parent) :
+    QObject(parent),
+    name(name),
+    candidates(mirror_list)
+{
+    cache = new QSettings("/var/cache/mx-package-manager/mirrors.conf", QSettings::IniFormat, this);
+    QSettings config("/etc/mx-package-manager.conf", QSettings::IniFormat);
+    ttl = config.value("Mirrors/ttl", 24 * 60 * 60).toInt();
+    for (int i = 0; i < candidates.size(); ++i) {
+        candidates[i] = candidates.at(i).trimmed();
+        if (!candidates.at(i).endsWith("/")) {
+            candidates[i] += "/";
+        }
+    }
+    manager = new QNetworkAccessManager(this);
+    time_limit = new Watchdog("mirrors", 5, 0, this);
+    connect(time_limit, &Watchdog::expired, this, &MirrorSelector::cancel);
+    running = 0;
+}
+
+bool MirrorSelector::isCached()
+{
+    qint64 time = cache->value(name + "/time").toLongLong();
+    return candidates.contains(cache->value(name + "/url").toString()) && QDateTime::currentMSecsSinceEpoch() - time < ttl * 1000LL;
+}
+
+// Return the cached choice if it's still valid, otherwise probe the candidates
+QString MirrorSelector::mirror(const QString &probe_path)
+{
+    if (isCached()) {
+        return cache->value(name + "/url").toString();
+    }
+    QString url = probe(probe_path);
+    if (url.isEmpty()) { // keep the old choice, don't save it so the next call probes again
+        return candidates.contains(cache->value(name + "/url").toString()) ? cache->value(name + "/url").toString() : candidates.value(0);
+    }
+    cache->setValue(name + "/url", url);
+    cache->setValue(name + "/time", QDateTime::currentMSecsSinceEpoch());
+    cache->sync();
+    return url;
+}
+
+void MirrorSelector::setCacheFile(const QString &file_name)
+{
+    delete cache;
+    cache = new QSettings(file_name, QSettings::IniFormat, this);
+}
+
+// Abort the probes that are still running
+void MirrorSelector::cancel()
+{
+    for (int i = 0; i < probes.size(); ++i) {
+        if (probes.at(i).reply) {
+            probes.at(i).reply->abort(); // emits finished
+        }
+    }
+}
+
+void MirrorSelector::onReadyRead()
+{
+    int i = indexOf(qobject_cast<QNetworkReply *>(sender()));
+    if (i == -1) {
+        return;
+    }
+    Probe &probe = probes[i];
+    if (probe.first_byte == -1) {
+        probe.first_byte = elapsed.elapsed();
+    }
+    probe.bytes += probe.reply->readAll().size();
+    if (probe.bytes >= probe_size) { // enough to estimate the speed, in case the server ignored the range
+        probe.ok = true;
+        probe.end = elapsed.elapsed();
+        probe.reply->abort();
+    }
+}
+
+void MirrorSelector::onReplyFinished()
+{
+    int i = indexOf(qobject_cast<QNetworkReply *>(sender()));
+    if (i == -1) {
+        return;
+    }
+    Probe &probe = probes[i];
+    if (!probe.ok) {
+        QNetworkReply::NetworkError error = probe.reply->error();
+        if (error == QNetworkReply::NoError) {
+            probe.bytes += probe.reply->readAll().size();
+        }
+        if (probe.first_byte == -1) {
+            probe.first_byte = elapsed.elapsed();
+        }
+        probe.end = elapsed.elapsed();
+        // slow mirrors aborted by the timeout are ranked by what they sent until then
+        probe.ok = probe.bytes > 0 && (error == QNetworkReply::NoError || error == QNetworkReply::OperationCanceledError);
+    }
+    probe.reply->deleteLater();
+    probe.reply = 0;
+    if (--running == 0) {
+        loop.quit();
+    }
+}
+
+int MirrorSelector::indexOf(QNetworkReply *reply)
+{
+    if (!reply) {
+        return -1;
+    }
+    for (int i = 0; i < probes.size(); ++i) {
+        if (probes.at(i).reply == reply) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Fetch the start of probe_path from all the candidates at once, measure time to first byte and throughput.
+// Returns the mirror with the lowest estimated time for reference_size, empty if none answered
+QString MirrorSelector::probe(const QString &probe_path)
+{
+    probes.clear();
+    running = 0;
+    elapsed.start();
+    foreach (const QString &candidate, candidates) {
+        Probe probe;
+        probe.url = candidate;
+        probe.first_byte = -1;
+        probe.end = 0;
+        probe.bytes = 0;
+        probe.ok = false;
+        QNetworkRequest request(QUrl(candidate + probe_path));
+        request.setRawHeader("Range", "bytes=0-" + QByteArray::number(probe_size - 1));
+        probe.reply = manager->get(request);
+        connect(probe.reply, &QNetworkReply::readyRead, this, &MirrorSelector::onReadyRead);
+        connect(probe.reply, &QNetworkReply::finished, this, &MirrorSelector::onReplyFinished);
+        probes << probe;
+        ++running;
+    }
+    if (running > 0) {
+        time_limit->start();
+        loop.exec();
+        time_limit->stop();
+    }
+
+    QString best;
+    double best_time = 0;
+    foreach (const Probe &probe, probes) {
+        if (!probe.ok) {
+            qDebug() << "mirror" << probe.url << "failed";
+            continue;
+        }
+        double throughput = probe.bytes / double(qMax(probe.end - probe.first_byte, qint64(1))); // bytes/ms
+        double time = probe.first_byte + reference_size / throughput;
+        qDebug() << "mirror" << probe.url << "ttfb:" << probe.first_byte << "ms throughput:" << qRound(throughput) << "KB/s estimate:" << qRound(time) << "ms";
+        if (best.isEmpty() || time < best_time) {
+            best = probe.url;
+            best_time = time;
+        }
+    }
+    probes.clear();
+    qDebug() << "selected mirror:" << best;
+    return best;
+}
@@ -0,0 +1,82 @@
+/**********************************************************************
+ *  mirrorselector.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef MIRRORSELECTOR_H
+#define MIRRORSELECTOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSettings>
+#include <QStringList>
+
+#include <watchdog.h>
+
+// Picks the fastest mirror by probing the candidates at the same time, the choice is cached for a while.
+// The cache time can be set in /etc/mx-package-manager.conf, section [Mirrors], the probing time by the "mirrors" limits
+class MirrorSelector : public QObject
+{
+    Q_OBJECT
+public:
+    MirrorSelector(const QString &name, const QStringList &mirror_list, QObject *parent = 0);
+
+    bool isCached(); // true if the last choice is still valid, mirror() won't probe
+    QString mirror(const QString &probe_path); // base url of the best mirror, probe_path is fetched from each candidate
+    void setCacheFile(const QString &file_name); // instead of /var/cache/mx-package-manager/mirrors.conf
+
+public slots:
+    void cancel();
+
+private slots:
+    void onReadyRead();
+    void onReplyFinished();
+
+private:
+    struct Probe {
+        QString url;
+        QNetworkReply *reply;
+        qint64 first_byte; // ms since the start of the probes, -1 until data arrives
+        qint64 end;
+        qint64 bytes;
+        bool ok;
+    };
+
+    QString name;
+    QStringList candidates;
+    int ttl; // seconds
+    QSettings *cache;
+    QNetworkAccessManager *manager;
+    QEventLoop loop;
+    QElapsedTimer elapsed;
+    Watchdog *time_limit;
+    QList<Probe> probes;
+    int running;
+
+    int indexOf(QNetworkReply *reply);
+    QString probe(const QString &probe_path);
+};
+
+#endif // MIRRORSELECTOR_H
@@ -21,7 +21,7 @@
 # * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
 # **********************************************************************/
 
-QT       += core gui xml network
+QT       += core gui xml network concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -33,13 +33,57 @@ SOURCES += main.cpp\
     cmd.cpp \
     mainwindow.cpp \
     lockfile.cpp \
-    versionnumber.cpp
+    versionnumber.cpp \
+    aptrunner.cpp \
+    transactionqueue.cpp \
+    scriptscheduler.cpp \
+    debprefetcher.cpp \
+    indexdownloader.cpp \
+    indexcache.cpp \
+    decompressor.cpp \
+    packagesparser.cpp \
+    pdiff.cpp \
+    mirrorselector.cpp \
+    connectivitymonitor.cpp \
+    fetchscheduler.cpp \
+    repoconfig.cpp \
+    watchdog.cpp \
+    packagestore.cpp \
+    packagemodel.cpp \
+    bitset.cpp \
+    nameindex.cpp \
+    fuzzysearch.cpp \
+    packagequery.cpp \
+    queryrunner.cpp
 
 HEADERS  += \
     cmd.h \
     mainwindow.h \
     lockfile.h \
-    versionnumber.h
+    versionnumber.h \
+    aptrunner.h \
+    transactionqueue.h \
+    scriptscheduler.h \
+    debprefetcher.h \
+    indexdownloader.h \
+    indexcache.h \
+    decompressor.h \
+    packagesparser.h \
+    pdiff.h \
+    mirrorselector.h \
+    connectivitymonitor.h \
+    fetchscheduler.h \
+    repoconfig.h \
+    watchdog.h \
+    packagestore.h \
+    packagemodel.h \
+    bitset.h \
+    nameindex.h \
+    fuzzysearch.h \
+    packagequery.h \
+    queryrunner.h
+
+LIBS += -lz -llzma
 
 FORMS    += \
     mainwindow.ui
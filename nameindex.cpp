@@ -0,0 +1,149 @@
+/**********************************************************************
+ *  nameindex.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "nameindex.h"
+
+#include <algorithm>
+#include <string.h>
+
+NameIndex::NameIndex() :
+    count(0)
+{
+    starts << 0;
+}
+
+// Collect (trigram, id) pairs, sort them and store the ids of each trigram contiguously
+NameIndex::NameIndex(const QStringList &names) :
+    count(names.size())
+{
+    QVector<quint64> pairs;
+    offsets.reserve(count);
+    for (int id = 0; id < count; ++id) {
+        QByteArray name = names.at(id).toLower().toUtf8();
+        offsets << this->names.size();
+        this->names += name;
+        this->names += '\0';
+        for (int i = 0; i + 3 <= name.size(); ++i) {
+            pairs << ((quint64(key(name.constData() + i)) << 32) | quint32(id));
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end()); // trigrams repeated in a name
+
+    ids.reserve(pairs.size());
+    for (int i = 0; i < pairs.size(); ++i) {
+        quint32 trigram = pairs.at(i) >> 32;
+        if (trigrams.isEmpty() || trigrams.last() != trigram) {
+            trigrams << trigram;
+            starts << ids.size();
+        }
+        ids << int(pairs.at(i) & 0xffffffff);
+    }
+    starts << ids.size();
+}
+
+Bitset NameIndex::find(const QString &text) const
+{
+    Bitset result(count);
+    QByteArray needle = text.toLower().toUtf8();
+    if (needle.size() < 3) { // no trigram to look up, check every name
+        for (int id = 0; id < count; ++id) {
+            if (contains(id, needle.constData())) {
+                result.setBit(id);
+            }
+        }
+        return result;
+    }
+
+    int lists = needle.size() - 2;
+    QVector<const int *> begins(lists);
+    QVector<const int *> ends(lists);
+    int shortest = 0;
+    for (int i = 0; i < lists; ++i) {
+        if (!postings(key(needle.constData() + i), &begins[i], &ends[i])) {
+            return result;
+        }
+        if (ends.at(i) - begins.at(i) < ends.at(shortest) - begins.at(shortest)) {
+            shortest = i;
+        }
+    }
+    // intersect starting with the shortest list, the candidates only get fewer
+    QVector<int> candidates;
+    candidates.reserve(ends.at(shortest) - begins.at(shortest));
+    for (const int *id = begins.at(shortest); id != ends.at(shortest); ++id) {
+        candidates << *id;
+    }
+    for (int i = 0; i < lists && !candidates.isEmpty(); ++i) {
+        if (i == shortest) {
+            continue;
+        }
+        const int *it = begins.at(i);
+        int kept = 0;
+        for (int j = 0; j < candidates.size(); ++j) {
+            it = std::lower_bound(it, ends.at(i), candidates.at(j));
+            if (it == ends.at(i)) {
+                break;
+            }
+            if (*it == candidates.at(j)) {
+                candidates[kept++] = candidates.at(j);
+            }
+        }
+        candidates.resize(kept);
+    }
+    // all the trigrams are there, check they are in the right order
+    foreach (int id, candidates) {
+        if (needle.size() == 3 || contains(id, needle.constData())) {
+            result.setBit(id);
+        }
+    }
+    return result;
+}
+
+qint64 NameIndex::memoryUsage() const
+{
+    return names.size() + (offsets.size() + starts.size() + ids.size()) * sizeof(int) + trigrams.size() * sizeof(quint32);
+}
+
+quint32 NameIndex::key(const char *text)
+{
+    return (quint32(uchar(text[0])) << 16) | (quint32(uchar(text[1])) << 8) | quint32(uchar(text[2]));
+}
+
+// Range of the ids of the names that contain the trigram, false if there are none
+bool NameIndex::postings(quint32 trigram, const int **begin, const int **end) const
+{
+    QVector<quint32>::const_iterator it = std::lower_bound(trigrams.constBegin(), trigrams.constEnd(), trigram);
+    if (it == trigrams.constEnd() || *it != trigram) {
+        return false;
+    }
+    int i = it - trigrams.constBegin();
+    *begin = ids.constData() + starts.at(i);
+    *end = ids.constData() + starts.at(i + 1);
+    return true;
+}
+
+bool NameIndex::contains(int id, const char *text) const
+{
+    return strstr(names.constData() + offsets.at(id), text) != 0;
+}
@@ -0,0 +1,59 @@
+/**********************************************************************
+ *  nameindex.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef NAMEINDEX_H
+#define NAMEINDEX_H
+
+#include <QByteArray>
+#include <QStringList>
+#include <QVector>
+
+#include <bitset.h>
+
+// Trigram index over lower-cased package names for substring search. Each trigram maps to the sorted ids
+// of the names that contain it; a query intersects the lists of its trigrams, starting with the shortest,
+// and only the remaining candidates are checked against the whole text
+class NameIndex
+{
+public:
+    NameIndex();
+    explicit NameIndex(const QStringList &names);
+
+    Bitset find(const QString &text) const; // names that contain text, case insensitive
+    qint64 memoryUsage() const; // in bytes
+
+private:
+    int count;
+    QByteArray names; // lower-cased UTF-8 names, each one followed by '\0'
+    QVector<int> offsets; // start of each name in names
+    QVector<quint32> trigrams; // sorted
+    QVector<int> starts; // ids of trigrams[i] are ids[starts[i]] up to ids[starts[i + 1]], one extra entry at the end
+    QVector<int> ids;
+
+    static quint32 key(const char *text);
+    bool postings(quint32 trigram, const int **begin, const int **end) const;
+    bool contains(int id, const char *text) const;
+};
+
+#endif // NAMEINDEX_H
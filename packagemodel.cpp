@@ -0,0 +1,287 @@
+/**********************************************************************
+ *  packagemodel.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "packagemodel.h"
+
+#include <QBrush>
+#include <QCoreApplication>
+
+PackageModel::PackageModel(QObject *parent) :
+    QAbstractItemModel(parent),
+    packages(new PackageStore()),
+    filtered(false)
+{
+    for (int i = 0; i < 4; ++i) {
+        checked_counts[i] = 0;
+    }
+    upgrade_icon = QIcon::fromTheme("software-update-available", QIcon(":/icons/software-update-available.png"));
+}
+
+void PackageModel::clear()
+{
+    setStore(PackageSnapshot(new PackageStore()));
+}
+
+// Switching stores doesn't copy or walk the packages
+void PackageModel::setStore(const PackageSnapshot &store)
+{
+    beginResetModel();
+    packages = store;
+    filtered = false;
+    rows.clear();
+    checked = Bitset(store->size());
+    for (int i = 0; i < 4; ++i) {
+        checked_counts[i] = 0;
+    }
+    endResetModel();
+}
+
+// Used while a list loads, each store has more packages or more statuses than the one before. When only the
+// statuses changed the rows stay as they are, otherwise the checked packages are found again by name
+void PackageModel::updateStore(const PackageSnapshot &store)
+{
+    if (store->samePackages(*packages)) {
+        packages = store;
+        for (int i = 0; i < 4; ++i) {
+            checked_counts[i] = 0;
+        }
+        foreach (int package, checked.indexes()) {
+            ++checked_counts[packages->status(package)];
+        }
+        if (rowCount() > 0) {
+            emit dataChanged(index(0, IconColumn), index(rowCount() - 1, DescriptionColumn),
+                             QVector<int>() << Qt::DecorationRole << Qt::ForegroundRole << Qt::ToolTipRole);
+        }
+        return;
+    }
+    QStringList names = checkedNames();
+    setStore(store);
+    foreach (const QString &name, names) {
+        int package = packages->indexOf(name);
+        if (package != -1) {
+            checked.setBit(package);
+            ++checked_counts[packages->status(package)];
+        }
+    }
+}
+
+const PackageStore &PackageModel::store() const
+{
+    return *packages;
+}
+
+PackageSnapshot PackageModel::snapshot() const
+{
+    return packages;
+}
+
+void PackageModel::setRows(const QVector<int> &rows)
+{
+    if (filtered && rows == this->rows) {
+        return; // same query run again for a store with new statuses, the view keeps its place
+    }
+    beginResetModel();
+    this->rows = rows;
+    filtered = true;
+    endResetModel();
+}
+
+// For rows that arrive in batches, after setRows()
+void PackageModel::appendRows(const QVector<int> &rows)
+{
+    if (rows.isEmpty()) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), this->rows.size(), this->rows.size() + rows.size() - 1);
+    this->rows += rows;
+    endInsertRows();
+}
+
+int PackageModel::rowOf(const QString &name) const
+{
+    int package = packages->indexOf(name);
+    if (package == -1 || !filtered) {
+        return package;
+    }
+    return rows.indexOf(package);
+}
+
+QStringList PackageModel::checkedNames() const
+{
+    QStringList names;
+    foreach (int package, checked.indexes()) {
+        names << packages->name(package);
+    }
+    return names;
+}
+
+int PackageModel::checkedCount() const
+{
+    return checked_counts[PackageStore::NotInstalled] + checked_counts[PackageStore::Installed]
+            + checked_counts[PackageStore::Upgradable] + checked_counts[PackageStore::Unknown];
+}
+
+int PackageModel::checkedCount(PackageStore::Status status) const
+{
+    return checked_counts[status];
+}
+
+void PackageModel::uncheckAll()
+{
+    checked = Bitset(packages->size());
+    for (int i = 0; i < 4; ++i) {
+        checked_counts[i] = 0;
+    }
+    if (rowCount() > 0) {
+        emit dataChanged(index(0, CheckColumn), index(rowCount() - 1, CheckColumn), QVector<int>() << Qt::CheckStateRole);
+    }
+}
+
+QModelIndex PackageModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || row < 0 || row >= rowCount() || column < 0 || column >= ColumnCount) {
+        return QModelIndex();
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex PackageModel::parent(const QModelIndex &child) const
+{
+    Q_UNUSED(child);
+    return QModelIndex();
+}
+
+int PackageModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return filtered ? rows.size() : packages->size();
+}
+
+int PackageModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant PackageModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) {
+        return QVariant();
+    }
+    int package = packageAt(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        if (index.column() == NameColumn) {
+            return packages->name(package);
+        } else if (index.column() == VersionColumn) {
+            return packages->version(package);
+        } else if (index.column() == DescriptionColumn) {
+            return packages->description(package);
+        }
+        break;
+    case Qt::CheckStateRole:
+        if (index.column() == CheckColumn) {
+            return checked.testBit(package) ? Qt::Checked : Qt::Unchecked;
+        }
+        break;
+    case Qt::DecorationRole:
+        if (index.column() == IconColumn && packages->status(package) == PackageStore::Upgradable) {
+            return upgrade_icon;
+        }
+        break;
+    case Qt::ForegroundRole:
+        if ((index.column() == NameColumn || index.column() == DescriptionColumn) && packages->status(package) == PackageStore::Installed) {
+            return QBrush(Qt::gray);
+        }
+        break;
+    case Qt::ToolTipRole:
+        return toolTip(package);
+    }
+    return QVariant();
+}
+
+bool PackageModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.column() != CheckColumn || role != Qt::CheckStateRole) {
+        return false;
+    }
+    int package = packageAt(index.row());
+    bool state = (value.toInt() == Qt::Checked);
+    if (checked.testBit(package) == state) {
+        return true;
+    }
+    checked.setBit(package, state);
+    checked_counts[packages->status(package)] += state ? 1 : -1;
+    emit dataChanged(index, index, QVector<int>() << Qt::CheckStateRole);
+    emit checkStateChanged(packages->name(package), state);
+    return true;
+}
+
+Qt::ItemFlags PackageModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    if (index.column() == CheckColumn) {
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+    }
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+QVariant PackageModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (section == NameColumn) {
+        return QCoreApplication::translate("MainWindow", "Package Name");
+    } else if (section == VersionColumn) {
+        return QCoreApplication::translate("MainWindow", "Version");
+    } else if (section == DescriptionColumn) {
+        return QCoreApplication::translate("MainWindow", "Description");
+    }
+    return QVariant();
+}
+
+int PackageModel::packageAt(int row) const
+{
+    return filtered ? rows.at(row) : row;
+}
+
+// Same tooltip on all the columns of a row. Texts are in the MainWindow context to keep the existing translations
+QString PackageModel::toolTip(int package) const
+{
+    QString installed = packages->installedVersion(package);
+    if (packages->status(package) == PackageStore::Unknown) {
+        return QCoreApplication::translate("MainWindow", "Checking the installed version...");
+    } else if (installed == "(none)") {
+        return QCoreApplication::translate("MainWindow", "Version ") + packages->candidateVersion(package) + QCoreApplication::translate("MainWindow", " in stable repo");
+    } else if (installed.isEmpty()) {
+        return QCoreApplication::translate("MainWindow", "Not available in stable repo");
+    } else if (packages->status(package) == PackageStore::Installed) {
+        return QCoreApplication::translate("MainWindow", "Latest version ") + installed + QCoreApplication::translate("MainWindow", " already installed");
+    }
+    return QCoreApplication::translate("MainWindow", "Version ") + installed + QCoreApplication::translate("MainWindow", " installed");
+}
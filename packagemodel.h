@@ -0,0 +1,81 @@
+/**********************************************************************
+ *  packagemodel.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef PACKAGEMODEL_H
+#define PACKAGEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QIcon>
+#include <QVector>
+
+#include <packagestore.h>
+
+// Flat model over a PackageStore for the Full App Catalog view. Nothing is stored per row, the data is
+// read from the shared store snapshot when the view asks for it; rows map to the packages that pass the filters
+class PackageModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    enum Column { CheckColumn, IconColumn, NameColumn, VersionColumn, DescriptionColumn, ColumnCount };
+
+    explicit PackageModel(QObject *parent = 0);
+
+    void clear();
+    void setStore(const PackageSnapshot &store); // shows all the packages, none checked
+    void updateStore(const PackageSnapshot &store); // newer store of the same repo, checked packages stay checked
+    const PackageStore &store() const;
+    PackageSnapshot snapshot() const;
+    void setRows(const QVector<int> &rows); // store indexes of the packages to show, in order
+    void appendRows(const QVector<int> &rows);
+    int rowOf(const QString &name) const; // -1 if the package is not shown
+    QStringList checkedNames() const;
+    int checkedCount() const;
+    int checkedCount(PackageStore::Status status) const; // checked packages with that status
+    void uncheckAll();
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &child) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+signals:
+    void checkStateChanged(const QString &name, bool checked);
+
+private:
+    PackageSnapshot packages;
+    bool filtered; // false: row n is package n, rows is not used
+    QVector<int> rows;
+    Bitset checked; // by store index
+    int checked_counts[4]; // by status, kept up to date on every change
+    QIcon upgrade_icon;
+
+    int packageAt(int row) const;
+    QString toolTip(int package) const;
+};
+
+#endif // PACKAGEMODEL_H
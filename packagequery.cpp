@@ -0,0 +1,293 @@
+/**********************************************************************
+ *  packagequery.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "packagequery.h"
+
+#include <QCoreApplication>
+
+#include <algorithm>
+
+PackageQuery::PackageQuery(const QString &text) :
+    scan(false)
+{
+    foreach (const QString &token, split(text)) {
+        if (!parseTerm(token)) {
+            words << token;
+        }
+    }
+}
+
+QString PackageQuery::error() const
+{
+    return error_text;
+}
+
+QString PackageQuery::freeText() const
+{
+    return words.join(" ");
+}
+
+bool PackageQuery::needsScan() const
+{
+    return scan;
+}
+
+// Intersect the store bitsets and the name index results, keep the other terms ordered by rank.
+// Only called once, the terms are replaced by the ones left to check
+Bitset PackageQuery::plan(const PackageStore &store, const Bitset &allowed)
+{
+    Bitset result = allowed;
+    QList<Term> scanned;
+    foreach (Term term, terms) {
+        // packages whose status is still Unknown match neither yes nor no
+        if (term.field == Installed) {
+            const Bitset &not_installed = store.statusBits(PackageStore::NotInstalled);
+            Bitset installed = store.statusBits(PackageStore::Installed) | store.statusBits(PackageStore::Upgradable);
+            result &= term.flag ? installed : not_installed;
+        } else if (term.field == Upgradable) {
+            const Bitset &upgradable = store.statusBits(PackageStore::Upgradable);
+            Bitset not_upgradable = store.statusBits(PackageStore::Installed) | store.statusBits(PackageStore::NotInstalled);
+            result &= term.flag ? upgradable : not_upgradable;
+        } else if (term.field == Library) {
+            result &= term.flag ? store.libraryBits() : ~store.libraryBits();
+        } else if (term.field == Name && term.op == Contains) {
+            result &= store.search(term.text);
+        } else if (term.field == Name && term.op == Equal) {
+            Bitset package(store.size());
+            int index = store.indexOf(term.text.toLower());
+            if (index != -1) {
+                package.setBit(index);
+            }
+            result &= package;
+        } else {
+            estimate(&term, store);
+            scanned << term;
+        }
+    }
+    std::stable_sort(scanned.begin(), scanned.end(), lessRank);
+    terms = scanned;
+    scan = !terms.isEmpty();
+    return result;
+}
+
+bool PackageQuery::matches(const PackageStore &store, int index) const
+{
+    foreach (const Term &term, terms) {
+        if (!test(term, store, index)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Split on white space, except inside double quotes
+QStringList PackageQuery::split(const QString &text)
+{
+    QStringList tokens;
+    QString token;
+    bool quoted = false;
+    foreach (const QChar &c, text) {
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c.isSpace() && !quoted) {
+            if (!token.isEmpty()) {
+                tokens << token;
+                token.clear();
+            }
+        } else {
+            token += c;
+        }
+    }
+    if (!token.isEmpty()) {
+        tokens << token;
+    }
+    return tokens;
+}
+
+// Field terms are <field><operator><value>, returns false for anything else (a free text word).
+// Terms without a value yet are ignored, invalid ones set the error
+bool PackageQuery::parseTerm(const QString &token)
+{
+    QRegularExpressionMatch match = QRegularExpression("^([a-z]+)(:~|:|<=|>=|<|>|=)(.*)$").match(token);
+    if (!match.hasMatch()) {
+        return false;
+    }
+    QString field = match.captured(1);
+    QString op = match.captured(2);
+    QString value = match.captured(3);
+
+    Term term;
+    term.op = Contains;
+    term.number = 0;
+    term.flag = false;
+    term.rank = 0;
+    if (field == "name") {
+        term.field = Name;
+    } else if (field == "description" || field == "desc") {
+        term.field = Description;
+    } else if (field == "section") {
+        term.field = Section;
+    } else if (field == "version") {
+        term.field = Version;
+    } else if (field == "size") {
+        term.field = Size;
+    } else if (field == "installed") {
+        term.field = Installed;
+    } else if (field == "upgradable") {
+        term.field = Upgradable;
+    } else if (field == "library" || field == "lib") {
+        term.field = Library;
+    } else {
+        return false;
+    }
+    if (value.isEmpty()) {
+        return true;
+    }
+
+    QString error;
+    if (term.field == Size) {
+        if (op == ":" || op == "=") {
+            term.op = Equal;
+        } else if (op == "<") {
+            term.op = Less;
+        } else if (op == "<=") {
+            term.op = LessEqual;
+        } else if (op == ">") {
+            term.op = Greater;
+        } else if (op == ">=") {
+            term.op = GreaterEqual;
+        }
+        QRegularExpressionMatch size = QRegularExpression("^(\\d+(\\.\\d+)?)([kmg]?)b?$",
+                                                          QRegularExpression::CaseInsensitiveOption).match(value);
+        if (op == ":~" || !size.hasMatch()) {
+            error = QCoreApplication::translate("PackageQuery", "Invalid size: %1").arg(value);
+        } else {
+            QString unit = size.captured(3).toLower();
+            qint64 factor = (unit == "g") ? 1024 * 1024 : (unit == "m") ? 1024 : 1;
+            term.number = qint64(size.captured(1).toDouble() * factor);
+        }
+    } else if (term.field == Installed || term.field == Upgradable || term.field == Library) {
+        QString answer = value.toLower();
+        if ((op == ":" || op == "=") && (answer == "yes" || answer == "true" || answer == "1")) {
+            term.flag = true;
+        } else if (!(op == ":" || op == "=") || !(answer == "no" || answer == "false" || answer == "0")) {
+            error = QCoreApplication::translate("PackageQuery", "%1 can only be yes or no").arg(field);
+        }
+    } else if (op == ":~") {
+        term.op = Match;
+        term.regex = QRegularExpression(value, QRegularExpression::CaseInsensitiveOption);
+        if (!term.regex.isValid()) {
+            error = QCoreApplication::translate("PackageQuery", "Invalid regular expression: %1").arg(term.regex.errorString());
+        }
+    } else if (op == ":" || op == "=") {
+        term.op = (op == ":") ? Contains : Equal;
+        term.text = value;
+    } else {
+        error = QCoreApplication::translate("PackageQuery", "Only size can be compared");
+    }
+
+    if (!error.isEmpty()) {
+        if (error_text.isEmpty()) {
+            error_text = error;
+        }
+    } else {
+        terms << term;
+    }
+    return true;
+}
+
+// Estimate the share of the packages that pass and the cost of checking one: terms that reject
+// more packages for less work are checked first. Sections are resolved here, once per section
+void PackageQuery::estimate(Term *term, const PackageStore &store)
+{
+    double pass = 0.1;
+    int cost = 4;
+    if (term->field == Section) {
+        term->sections.fill(false, store.sectionCount());
+        int count = 0;
+        for (int section = 0; section < store.sectionCount(); ++section) {
+            QString name = store.sectionName(section);
+            bool ok;
+            if (term->op == Match) {
+                ok = term->regex.match(name).hasMatch();
+            } else if (term->op == Equal) {
+                ok = name.compare(term->text, Qt::CaseInsensitive) == 0;
+            } else {
+                ok = name.contains(term->text, Qt::CaseInsensitive);
+            }
+            if (ok) {
+                term->sections[section] = true;
+                count += store.sectionSize(section);
+            }
+        }
+        pass = (store.size() > 0) ? double(count) / store.size() : 0;
+        cost = 1;
+    } else if (term->field == Size) {
+        pass = (term->op == Equal) ? 0.01 : 0.5;
+        cost = 1;
+    } else if (term->op == Match) {
+        cost = 20;
+    } else {
+        pass = (term->op == Equal) ? 0.01 : 0.1;
+        cost = (term->field == Description) ? 8 : 4;
+    }
+    term->rank = cost / qMax(0.01, 1 - pass);
+}
+
+// Packages with an unknown size don't pass size terms
+bool PackageQuery::test(const Term &term, const PackageStore &store, int index) const
+{
+    if (term.field == Section) {
+        return term.sections.at(store.sectionOf(index));
+    }
+    if (term.field == Size) {
+        qint64 size = store.installedSize(index);
+        switch (term.op) {
+        case Less:
+            return size > 0 && size < term.number;
+        case LessEqual:
+            return size > 0 && size <= term.number;
+        case Greater:
+            return size > term.number;
+        case GreaterEqual:
+            return size > 0 && size >= term.number;
+        default:
+            return size > 0 && size == term.number;
+        }
+    }
+    QString text = (term.field == Name) ? store.name(index) : (term.field == Description) ? store.description(index)
+                                                                                            : store.version(index);
+    if (term.op == Match) {
+        return term.regex.match(text).hasMatch();
+    }
+    if (term.op == Equal) {
+        return text.compare(term.text, Qt::CaseInsensitive) == 0;
+    }
+    return text.contains(term.text, Qt::CaseInsensitive);
+}
+
+bool PackageQuery::lessRank(const Term &a, const Term &b)
+{
+    return a.rank < b.rank;
+}
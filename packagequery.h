@@ -0,0 +1,81 @@
+/**********************************************************************
+ *  packagequery.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef PACKAGEQUERY_H
+#define PACKAGEQUERY_H
+
+#include <QList>
+#include <QRegularExpression>
+#include <QStringList>
+#include <QVector>
+
+#include <bitset.h>
+#include <packagestore.h>
+
+// Search text with field terms, e.g. "section:games installed:no size<50M name:~^python3- player"
+//   name, description (desc), section, version:  field:text (contains), field=text, field:~regex
+//   size (installed size, K/M/G suffix, KB if none): size<N, size<=N, size>N, size>=N, size=N
+//   installed, upgradable, library (lib):          field:yes or field:no
+// Words that are not field terms are ranked as free text over the packages that pass the terms.
+// plan() applies the terms that have an index in the store and orders the others by selectivity;
+// matches() then checks those on the remaining packages and can run on several threads at once
+class PackageQuery
+{
+public:
+    explicit PackageQuery(const QString &text = QString());
+
+    QString error() const; // empty if the query is valid
+    QString freeText() const;
+    bool needsScan() const; // some terms have to be checked package by package, after plan()
+
+    Bitset plan(const PackageStore &store, const Bitset &allowed); // packages that pass the indexed terms
+    bool matches(const PackageStore &store, int index) const; // the other terms, in plan order
+
+private:
+    enum Field { Name, Description, Section, Version, Size, Installed, Upgradable, Library };
+    enum Op { Contains, Equal, Match, Less, LessEqual, Greater, GreaterEqual };
+    struct Term {
+        Field field;
+        Op op;
+        QString text;
+        QRegularExpression regex;
+        qint64 number; // size in KB
+        bool flag;
+        QVector<bool> sections; // sections that pass, by section number
+        double rank; // checked in increasing order
+    };
+
+    QList<Term> terms;
+    QStringList words;
+    QString error_text;
+    bool scan;
+
+    static QStringList split(const QString &text);
+    bool parseTerm(const QString &token);
+    void estimate(Term *term, const PackageStore &store);
+    bool test(const Term &term, const PackageStore &store, int index) const;
+    static bool lessRank(const Term &a, const Term &b);
+};
+
+#endif // PACKAGEQUERY_H
@@ -0,0 +1,92 @@
+/**********************************************************************
+ *  packagesparser.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "packagesparser.h"
+
+PackagesParser::PackagesParser()
+{
+}
+
+// Process all the complete lines, keep the rest for the next feed
+void PackagesParser::feed(const QByteArray &data)
+{
+    buffer += data;
+    int start = 0;
+    int end;
+    while ((end = buffer.indexOf('\n', start)) != -1) {
+        processLine(buffer.mid(start, end - start));
+        start = end + 1;
+    }
+    buffer.remove(0, start);
+}
+
+void PackagesParser::finish()
+{
+    if (!buffer.isEmpty()) {
+        processLine(buffer);
+        buffer.clear();
+    }
+    endStanza();
+}
+
+int PackagesParser::count()
+{
+    return package_map.size();
+}
+
+QMap<QString, QStringList> PackagesParser::packages()
+{
+    return package_map;
+}
+
+// Add the package when reaching the end of its stanza
+void PackagesParser::endStanza()
+{
+    if (!name.isEmpty()) {
+        package_map.insert(name, QStringList() << version << description << section << installed_size);
+    }
+    name.clear();
+    version.clear();
+    description.clear();
+    section.clear();
+    installed_size.clear();
+}
+
+// Only the first line of the description is used
+void PackagesParser::processLine(const QByteArray &line)
+{
+    if (line.isEmpty()) {
+        endStanza();
+    } else if (line.startsWith("Package: ")) {
+        name = QString::fromUtf8(line.mid(9)).trimmed();
+    } else if (line.startsWith("Version: ")) {
+        version = QString::fromUtf8(line.mid(9)).trimmed();
+    } else if (line.startsWith("Description: ")) {
+        description = QString::fromUtf8(line.mid(13)).trimmed();
+    } else if (line.startsWith("Section: ")) {
+        section = QString::fromUtf8(line.mid(9)).trimmed();
+    } else if (line.startsWith("Installed-Size: ")) {
+        installed_size = QString::fromUtf8(line.mid(16)).trimmed();
+    }
+}
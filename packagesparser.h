@@ -0,0 +1,56 @@
+/**********************************************************************
+ *  packagesparser.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef PACKAGESPARSER_H
+#define PACKAGESPARSER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QStringList>
+
+// Incremental parser for Debian Packages files, text can be fed in chunks of any size
+class PackagesParser
+{
+public:
+    PackagesParser();
+
+    void feed(const QByteArray &data);
+    void finish(); // process the last stanza
+    int count(); // packages parsed so far
+    QMap<QString, QStringList> packages(); // package name -> (version, description, section, installed size in KB)
+
+private:
+    QByteArray buffer; // incomplete line between feeds
+    QString name;
+    QString version;
+    QString description;
+    QString section;
+    QString installed_size;
+    QMap<QString, QStringList> package_map;
+
+    void endStanza();
+    void processLine(const QByteArray &line);
+};
+
+#endif // PACKAGESPARSER_H
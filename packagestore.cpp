@@ -0,0 +1,278 @@
+/**********************************************************************
+ *  packagestore.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "packagestore.h"
+
+#include <algorithm>
+
+PackageStore::PackageStore() :
+    name_index(new NameIndex()),
+    fuzzy_search(new FuzzySearch()),
+    memory(sizeof(PackageStore))
+{
+    for (int i = 0; i < 4; ++i) {
+        status_counts[i] = 0;
+    }
+}
+
+// Work out the status and the library classification of each package once, the view and the filters only read them
+PackageStore::PackageStore(const QMap<QString, QStringList> &list, const QHash<QString, VersionNumber> &installed,
+                           const QHash<QString, VersionNumber> &candidates, int classified) :
+    memory(sizeof(PackageStore))
+{
+    library_bits = Bitset(list.size());
+    names.reserve(list.size());
+    versions.reserve(list.size());
+    descriptions.reserve(list.size());
+    installed_sizes.reserve(list.size());
+    package_sections.reserve(list.size());
+    QHash<QString, int> section_numbers;
+
+    QMap<QString, QStringList>::const_iterator it;
+    for (it = list.constBegin(); it != list.constEnd(); ++it) {
+        const QString &name = it.key();
+        if ((name.startsWith("lib") && !name.startsWith("libreoffice")) || name.endsWith("-dev")) {
+            library_bits.setBit(names.size());
+        }
+        names << name;
+        versions << it.value().at(0);
+        descriptions << it.value().at(1);
+        installed_sizes << it.value().value(3).toInt();
+        QString section = it.value().value(2);
+        int number = section_numbers.value(section, -1);
+        if (number == -1) {
+            number = section_names.size();
+            section_numbers.insert(section, number);
+            section_names << section;
+            section_sizes << 0;
+        }
+        package_sections << number;
+        ++section_sizes[number];
+    }
+    classify(installed, candidates, classified);
+    name_index = QSharedPointer<const NameIndex>(new NameIndex(names));
+    fuzzy_search = QSharedPointer<const FuzzySearch>(new FuzzySearch(names, descriptions));
+    countMemory();
+}
+
+// The lists are implicitly shared and the indexes are shared pointers, so only the statuses are built here
+PackageStore::PackageStore(const PackageStore &base, const QHash<QString, VersionNumber> &installed,
+                           const QHash<QString, VersionNumber> &candidates, int classified) :
+    names(base.names),
+    versions(base.versions),
+    descriptions(base.descriptions),
+    installed_sizes(base.installed_sizes),
+    package_sections(base.package_sections),
+    section_names(base.section_names),
+    section_sizes(base.section_sizes),
+    library_bits(base.library_bits),
+    name_index(base.name_index),
+    fuzzy_search(base.fuzzy_search),
+    memory(sizeof(PackageStore))
+{
+    classify(installed, candidates, classified);
+    countMemory();
+}
+
+int PackageStore::size() const
+{
+    return names.size();
+}
+
+int PackageStore::count(Status status) const
+{
+    return status_counts[status];
+}
+
+PackageStats PackageStore::stats() const
+{
+    PackageStats stats;
+    stats.total = names.size();
+    stats.installed = status_counts[Installed] + status_counts[Upgradable];
+    stats.upgradable = status_counts[Upgradable];
+    return stats;
+}
+
+bool PackageStore::samePackages(const PackageStore &other) const
+{
+    return size() == other.size() && name_index == other.name_index;
+}
+
+int PackageStore::memoryCost() const
+{
+    return memory / 1024 + 1;
+}
+
+// Binary search, the names are sorted
+int PackageStore::indexOf(const QString &name) const
+{
+    QStringList::const_iterator it = std::lower_bound(names.constBegin(), names.constEnd(), name);
+    if (it == names.constEnd() || *it != name) {
+        return -1;
+    }
+    return it - names.constBegin();
+}
+
+// Uses the trigram index, only names that have all the trigrams of text are compared
+Bitset PackageStore::search(const QString &text) const
+{
+    return name_index->find(text);
+}
+
+// Only the allowed packages are scored, at most limit of them are returned
+QVector<int> PackageStore::rank(const QString &text, const Bitset &allowed, int limit, int *total) const
+{
+    return fuzzy_search->find(text, allowed, limit, total);
+}
+
+QString PackageStore::name(int index) const
+{
+    return names.at(index);
+}
+
+QString PackageStore::version(int index) const
+{
+    return versions.at(index);
+}
+
+QString PackageStore::description(int index) const
+{
+    return descriptions.at(index);
+}
+
+QString PackageStore::section(int index) const
+{
+    return section_names.at(package_sections.at(index));
+}
+
+int PackageStore::installedSize(int index) const
+{
+    return installed_sizes.at(index);
+}
+
+QString PackageStore::installedVersion(int index) const
+{
+    return installed_versions.at(index);
+}
+
+QString PackageStore::candidateVersion(int index) const
+{
+    return candidate_versions.at(index);
+}
+
+PackageStore::Status PackageStore::status(int index) const
+{
+    if (status_bits[Upgradable].testBit(index)) {
+        return Upgradable;
+    } else if (status_bits[Installed].testBit(index)) {
+        return Installed;
+    }
+    return status_bits[NotInstalled].testBit(index) ? NotInstalled : Unknown;
+}
+
+bool PackageStore::isLibrary(int index) const
+{
+    return library_bits.testBit(index);
+}
+
+const Bitset &PackageStore::statusBits(Status status) const
+{
+    return status_bits[status];
+}
+
+const Bitset &PackageStore::libraryBits() const
+{
+    return library_bits;
+}
+
+int PackageStore::sectionCount() const
+{
+    return section_names.size();
+}
+
+QString PackageStore::sectionName(int section) const
+{
+    return section_names.at(section);
+}
+
+int PackageStore::sectionSize(int section) const
+{
+    return section_sizes.at(section);
+}
+
+int PackageStore::sectionOf(int index) const
+{
+    return package_sections.at(index);
+}
+
+// Set the installed and candidate versions and the status of each package
+void PackageStore::classify(const QHash<QString, VersionNumber> &installed, const QHash<QString, VersionNumber> &candidates,
+                            int classified)
+{
+    for (int i = 0; i < 4; ++i) {
+        status_bits[i] = Bitset(names.size());
+        status_counts[i] = 0;
+    }
+    installed_versions.clear();
+    candidate_versions.clear();
+    installed_versions.reserve(names.size());
+    candidate_versions.reserve(names.size());
+    for (int i = 0; i < names.size(); ++i) {
+        const QString &name = names.at(i);
+        VersionNumber installed_version = installed.value(name);
+        VersionNumber repo_candidate(versions.at(i)); // candidate from the repo, might be different than the one from Stable
+        Status status;
+        if (classified != -1 && i >= classified) {
+            status = Unknown;
+        } else if (installed_version.toString() == "(none)" || installed_version.toString() == "") {
+            status = NotInstalled;
+        } else if (installed_version >= repo_candidate) {
+            status = Installed;
+        } else {
+            status = Upgradable;
+        }
+        status_bits[status].setBit(i);
+        ++status_counts[status];
+        installed_versions << installed_version.toString();
+        candidate_versions << candidates.value(name).toString();
+    }
+}
+
+// Estimate the memory used, the data shared with other snapshots of the same list is counted in each one
+void PackageStore::countMemory()
+{
+    // string data plus the QString headers and list entries
+    const int string_overhead = 2 * sizeof(void *) + 16;
+    QList<const QStringList *> fields;
+    fields << &names << &versions << &descriptions << &installed_versions << &candidate_versions;
+    foreach (const QStringList *field, fields) {
+        foreach (const QString &string, *field) {
+            memory += string.size() * sizeof(QChar) + string_overhead;
+        }
+    }
+    memory += 5 * (names.size() / 8 + 8); // bitsets
+    memory += names.size() * (sizeof(int) + sizeof(quint16)); // sizes and sections
+    memory += name_index->memoryUsage();
+    memory += fuzzy_search->memoryUsage();
+}
@@ -0,0 +1,116 @@
+/**********************************************************************
+ *  packagestore.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef PACKAGESTORE_H
+#define PACKAGESTORE_H
+
+#include <QHash>
+#include <QMap>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+
+#include <bitset.h>
+#include <fuzzysearch.h>
+#include <nameindex.h>
+#include <versionnumber.h>
+
+// Package counts of a store, small enough to keep after the store itself is dropped
+struct PackageStats
+{
+    int total;
+    int installed; // including the upgradable ones
+    int upgradable;
+};
+
+// Packages of one repo with their installed state, sorted by name. Each field is kept in its own list
+// indexed by package number. A store doesn't change once built, it's shared as a PackageSnapshot
+class PackageStore
+{
+public:
+    enum Status { NotInstalled, Installed, Upgradable, Unknown }; // Unknown: apt wasn't asked yet, while a list loads
+
+    PackageStore();
+    // list is name -> (version, description, section, installed size), installed and candidates are the versions reported by apt-cache policy.
+    // Only the first classified packages in name order were looked up, the rest are Unknown; -1 if all were
+    PackageStore(const QMap<QString, QStringList> &list, const QHash<QString, VersionNumber> &installed,
+                 const QHash<QString, VersionNumber> &candidates, int classified = -1);
+    // same packages as base with the statuses worked out again, the package data and search indexes are shared with it
+    PackageStore(const PackageStore &base, const QHash<QString, VersionNumber> &installed,
+                 const QHash<QString, VersionNumber> &candidates, int classified = -1);
+
+    int size() const;
+    int count(Status status) const;
+    PackageStats stats() const; // counted while the statuses are worked out
+    int memoryCost() const; // estimated memory used, in KB
+    bool samePackages(const PackageStore &other) const; // built from the same base, only the statuses can differ
+    int indexOf(const QString &name) const; // -1 if not found
+    Bitset search(const QString &text) const; // packages whose name contains text, case insensitive
+    // best name/description matches first, total is set to the number of matches before the limit
+    QVector<int> rank(const QString &text, const Bitset &allowed, int limit, int *total = 0) const;
+
+    QString name(int index) const;
+    QString version(int index) const;
+    QString description(int index) const;
+    QString section(int index) const;
+    int installedSize(int index) const; // in KB, 0 if not known
+    QString installedVersion(int index) const; // "(none)" if not installed, empty if apt doesn't know the package
+    QString candidateVersion(int index) const; // version apt would install from the enabled sources
+    Status status(int index) const;
+    bool isLibrary(int index) const; // lib* (except libreoffice) and *-dev packages
+
+    // one bit per package, for filtering
+    const Bitset &statusBits(Status status) const;
+    const Bitset &libraryBits() const;
+
+    // sections are numbered, each package refers to its section by number
+    int sectionCount() const;
+    QString sectionName(int section) const;
+    int sectionSize(int section) const; // number of packages in the section
+    int sectionOf(int index) const;
+
+private:
+    QStringList names;
+    QStringList versions;
+    QStringList descriptions;
+    QStringList installed_versions;
+    QStringList candidate_versions;
+    QVector<int> installed_sizes;
+    QVector<quint16> package_sections;
+    QStringList section_names;
+    QVector<int> section_sizes;
+    Bitset status_bits[4];
+    int status_counts[4];
+    Bitset library_bits;
+    QSharedPointer<const NameIndex> name_index;
+    QSharedPointer<const FuzzySearch> fuzzy_search;
+    qint64 memory;
+
+    void classify(const QHash<QString, VersionNumber> &installed, const QHash<QString, VersionNumber> &candidates, int classified);
+    void countMemory();
+};
+
+typedef QSharedPointer<const PackageStore> PackageSnapshot;
+
+#endif // PACKAGESTORE_H
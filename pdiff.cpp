@@ -0,0 +1,162 @@
+/**********************************************************************
+ *  pdiff.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "pdiff.h"
+
+#include <QDebug>
+
+PDiff::PDiff() :
+    hash_algorithm(QCryptographicHash::Sha256),
+    merged(false)
+{
+}
+
+// Parse the index, SHA256 fields are used when present, otherwise SHA1.
+// Returns false if the index doesn't have a current hash
+bool PDiff::parseIndex(const QByteArray &data)
+{
+    QString prefix = data.contains("SHA256-Current:") ? "SHA256" : "SHA1";
+    hash_algorithm = (prefix == "SHA256") ? QCryptographicHash::Sha256 : QCryptographicHash::Sha1;
+    QString section;
+    foreach (const QByteArray &line, data.split('\n')) {
+        if (line.startsWith(' ')) { // " <hash> <size> <name>" lines of the list fields
+            QList<QByteArray> fields = line.simplified().split(' ');
+            if (fields.size() != 3) {
+                continue;
+            }
+            QString name = QString(fields.at(2));
+            if (section == prefix + "-History") {
+                history_hashes << fields.at(0);
+                history_names << name;
+            } else if (section == prefix + "-Download") {
+                if (name.endsWith(".gz")) {
+                    download_hashes.insert(name.left(name.length() - 3), fields.at(0));
+                }
+            } else if (section == prefix + "-Patches") {
+                patch_hashes.insert(name, fields.at(0));
+            }
+            continue;
+        }
+        int colon = line.indexOf(':');
+        section = QString(colon == -1 ? line : line.left(colon));
+        QByteArray value = (colon == -1) ? QByteArray() : line.mid(colon + 1).trimmed();
+        if (section == prefix + "-Current") {
+            current_hash = value.split(' ').at(0);
+        } else if (section == "X-Patch-Precedence") {
+            merged = (value == "merged");
+        }
+    }
+    return !current_hash.isEmpty();
+}
+
+QCryptographicHash::Algorithm PDiff::algorithm()
+{
+    return hash_algorithm;
+}
+
+QByteArray PDiff::currentHash()
+{
+    return current_hash;
+}
+
+// Each history entry is the hash of an older file and the patch that updates it to the next version
+QList<PDiff::Patch> PDiff::patchesFrom(const QByteArray &hash)
+{
+    QList<Patch> patches;
+    int start = history_hashes.indexOf(hash);
+    if (start == -1) {
+        return patches;
+    }
+    int end = merged ? start + 1 : history_names.size();
+    for (int i = start; i < end; ++i) {
+        Patch patch;
+        patch.name = history_names.at(i);
+        patch.download_hash = download_hashes.value(patch.name);
+        patch.patch_hash = patch_hashes.value(patch.name);
+        patches << patch;
+    }
+    return patches;
+}
+
+// Apply a "diff --ed" script to the lines of a file. Commands come in descending line order
+// so each one can be applied as it's read. Returns false if the script doesn't fit the file
+bool PDiff::apply(QList<QByteArray> *lines, const QByteArray &script)
+{
+    QList<QByteArray> commands = script.split('\n');
+    int current = -1; // last line added, used by "s/.//"
+    int i = 0;
+    while (i < commands.size()) {
+        QByteArray command = commands.at(i++);
+        if (command.isEmpty()) {
+            continue;
+        }
+        if (command == "s/.//") { // the line was a single "." escaped as ".."
+            if (current < 0 || current >= lines->size()) {
+                return false;
+            }
+            (*lines)[current].remove(0, 1);
+            continue;
+        }
+        char op = command.at(command.size() - 1);
+        QList<QByteArray> range = command.left(command.size() - 1).split(',');
+        bool ok_first = true;
+        bool ok_last = true;
+        int first;
+        if (command == "a") { // append after the current line, used after "s/.//"
+            first = current + 1;
+        } else {
+            first = range.at(0).toInt(&ok_first);
+        }
+        int last = (range.size() == 2) ? range.at(1).toInt(&ok_last) : first;
+        if (!ok_first || !ok_last || range.size() > 2 || first < 0 || first > last || last > lines->size()) {
+            qDebug() << "Invalid patch command:" << command;
+            return false;
+        }
+        if (op == 'd' || op == 'c') {
+            if (first < 1) {
+                return false;
+            }
+            lines->erase(lines->begin() + first - 1, lines->begin() + last);
+        }
+        if (op == 'a' || op == 'c') {
+            int pos = (op == 'a') ? last : first - 1;
+            current = pos - 1;
+            while (true) {
+                if (i >= commands.size()) {
+                    return false; // text not terminated
+                }
+                QByteArray text = commands.at(i++);
+                if (text == ".") {
+                    break;
+                }
+                lines->insert(pos++, text);
+                current = pos - 1;
+            }
+        } else if (op != 'd') {
+            qDebug() << "Unsupported patch command:" << command;
+            return false;
+        }
+    }
+    return true;
+}
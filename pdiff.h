@@ -0,0 +1,63 @@
+/**********************************************************************
+ *  pdiff.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef PDIFF_H
+#define PDIFF_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+// Reads a Packages.diff/Index file and applies the ed style patches it lists
+class PDiff
+{
+public:
+    struct Patch {
+        QString name;
+        QByteArray download_hash; // of the .gz file, empty if not listed
+        QByteArray patch_hash; // of the uncompressed patch, empty if not listed
+    };
+
+    PDiff();
+
+    bool parseIndex(const QByteArray &data);
+    QCryptographicHash::Algorithm algorithm();
+    QByteArray currentHash();
+    QList<Patch> patchesFrom(const QByteArray &hash); // patches to apply to the file with this hash, empty if not in the history
+
+    static bool apply(QList<QByteArray> *lines, const QByteArray &script);
+
+private:
+    QCryptographicHash::Algorithm hash_algorithm;
+    QByteArray current_hash;
+    QList<QByteArray> history_hashes;
+    QList<QString> history_names;
+    QMap<QString, QByteArray> download_hashes;
+    QMap<QString, QByteArray> patch_hashes;
+    bool merged; // each patch applies to the current file directly
+};
+
+#endif // PDIFF_H
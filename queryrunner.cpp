@@ -0,0 +1,200 @@
+/**********************************************************************
+ *  queryrunner.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "queryrunner.h"
+
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+QueryRunner::QueryRunner(QObject *parent) :
+    QObject(parent),
+    replace(true),
+    job_generation(0),
+    next_result(0),
+    sent(0),
+    generation(new QAtomicInt(0)),
+    watcher(0)
+{
+}
+
+// A running job stops at its next check instead of holding up the exit
+QueryRunner::~QueryRunner()
+{
+    cancel();
+}
+
+// The query is parsed here to report errors right away, the rest runs on the thread pool
+QString QueryRunner::start(const PackageSnapshot &store, const QString &text, const Bitset &allowed, int limit)
+{
+    cancel();
+    this->store = store;
+    replace = true;
+    next_result = 0;
+    sent = 0;
+    total = QSharedPointer<QAtomicInt>(new QAtomicInt(0));
+    QSharedPointer<PackageQuery> query(new PackageQuery(text));
+    if (!query->error().isEmpty()) {
+        emit rowsReady(QVector<int>(), true);
+        emit finished();
+        return query->error();
+    }
+
+    QFutureInterface<QVector<int> > results;
+    results.reportStarted();
+    watcher = new QFutureWatcher<QVector<int> >(this);
+    connect(watcher, &QFutureWatcher<QVector<int> >::resultsReadyAt, this, &QueryRunner::jobReady);
+    connect(watcher, &QFutureWatcher<QVector<int> >::finished, this, &QueryRunner::jobFinished);
+    watcher->setFuture(results.future());
+    job_generation = generation->load();
+    QThreadPool::globalInstance()->start(new Job(store, query, allowed, limit, generation, total, results));
+    return QString();
+}
+
+// Makes the running job stop at its next check, its results are dropped with its watcher
+void QueryRunner::cancel()
+{
+    generation->fetchAndAddOrdered(1);
+    if (watcher) {
+        watcher->disconnect(this);
+        watcher->deleteLater();
+        watcher = 0;
+    }
+}
+
+PackageSnapshot QueryRunner::snapshot() const
+{
+    return store;
+}
+
+// Send the batches that are ready and follow the ones already sent
+void QueryRunner::jobReady()
+{
+    if (!watcher || job_generation != generation->load()) {
+        return;
+    }
+    QFuture<QVector<int> > future = watcher->future();
+    while (future.isResultReadyAt(next_result)) {
+        QVector<int> rows = future.resultAt(next_result++);
+        sent += rows.size();
+        if (replace || !rows.isEmpty()) {
+            emit rowsReady(rows, replace);
+            replace = false;
+        }
+    }
+}
+
+void QueryRunner::jobFinished()
+{
+    jobReady();
+    if (job_generation != generation->load()) {
+        return;
+    }
+    if (replace) { // no batch at all
+        emit rowsReady(QVector<int>(), true);
+        replace = false;
+    }
+    if (total->load() > sent) {
+        emit limited(sent, total->load());
+    }
+    watcher->deleteLater();
+    watcher = 0;
+    emit finished();
+}
+
+QueryRunner::Job::Job(const PackageSnapshot &store, const QSharedPointer<PackageQuery> &query, const Bitset &allowed,
+                      int limit, const QSharedPointer<QAtomicInt> &generation, const QSharedPointer<QAtomicInt> &total,
+                      const QFutureInterface<QVector<int> > &results) :
+    store(store),
+    query(query),
+    allowed(allowed),
+    limit(limit),
+    generation(generation),
+    job_generation(generation->load()),
+    total(total),
+    results(results)
+{
+}
+
+// Check the packages left after planning a batch at a time, one chunk per core in each batch
+void QueryRunner::Job::run()
+{
+    Bitset candidates = query->plan(*store, allowed);
+    bool ranked = !query->freeText().isEmpty();
+    int index = 0;
+    if (query->needsScan()) {
+        QVector<int> ids = candidates.indexes();
+        const int min_chunk = 1024;
+        int threads = qMax(1, QThread::idealThreadCount());
+        int chunk_size = qMax(min_chunk, ids.size() / (4 * threads) + 1);
+        if (ranked) {
+            candidates = Bitset(store->size());
+        }
+        for (int begin = 0; begin < ids.size() && !stale(); ) {
+            QList<Chunk> chunks;
+            for (int i = 0; i < threads && begin < ids.size(); ++i, begin += chunk_size) {
+                Chunk chunk;
+                chunk.store = store;
+                chunk.query = query;
+                chunk.ids = ids.mid(begin, chunk_size);
+                chunks << chunk;
+            }
+            foreach (const QVector<int> &rows, QtConcurrent::blockingMapped<QList<QVector<int> > >(chunks, &Job::scan)) {
+                if (ranked) {
+                    foreach (int id, rows) {
+                        candidates.setBit(id);
+                    }
+                } else {
+                    results.reportResult(rows, index++);
+                }
+            }
+        }
+    } else if (!ranked) {
+        results.reportResult(candidates.indexes(), index++);
+    }
+    if (ranked && !stale()) {
+        int matches;
+        QVector<int> rows = store->rank(query->freeText(), candidates, limit, &matches);
+        total->store(matches);
+        results.reportResult(rows, index++);
+    }
+    results.reportFinished();
+}
+
+// A newer query was started
+bool QueryRunner::Job::stale() const
+{
+    return generation->load() != job_generation;
+}
+
+QVector<int> QueryRunner::Job::scan(const Chunk &chunk)
+{
+    QVector<int> rows;
+    foreach (int id, chunk.ids) {
+        if (chunk.query->matches(*chunk.store, id)) {
+            rows << id;
+        }
+    }
+    return rows;
+}
@@ -0,0 +1,102 @@
+/**********************************************************************
+ *  queryrunner.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef QUERYRUNNER_H
+#define QUERYRUNNER_H
+
+#include <QAtomicInt>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <packagequery.h>
+#include <packagestore.h>
+
+// Runs a PackageQuery on a store snapshot on a pool thread. Every start() bumps the generation counter;
+// a job checks it between batches and stops once a newer query exists, and only the rows of the newest
+// query reach the view. The packages left after the indexed terms are checked in parallel batches and
+// the matches are sent, in order, batch by batch. With free text the matches are ranked and sent at once
+class QueryRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QueryRunner(QObject *parent = 0);
+    ~QueryRunner();
+
+    QString start(const PackageSnapshot &store, const QString &text, const Bitset &allowed, int limit); // returns the query error
+    void cancel();
+    PackageSnapshot snapshot() const; // store of the last query
+
+signals:
+    void rowsReady(const QVector<int> &rows, bool replace); // replace the shown rows or add to them
+    void limited(int shown, int total); // ranked matches were capped at the limit, sent before finished
+    void finished();
+
+private slots:
+    void jobReady();
+    void jobFinished();
+
+private:
+    // Plans and runs one query, reports one result per batch of rows
+    class Job : public QRunnable
+    {
+    public:
+        Job(const PackageSnapshot &store, const QSharedPointer<PackageQuery> &query, const Bitset &allowed, int limit,
+            const QSharedPointer<QAtomicInt> &generation, const QSharedPointer<QAtomicInt> &total,
+            const QFutureInterface<QVector<int> > &results);
+        void run();
+
+    private:
+        struct Chunk {
+            PackageSnapshot store;
+            QSharedPointer<const PackageQuery> query;
+            QVector<int> ids;
+        };
+        PackageSnapshot store;
+        QSharedPointer<PackageQuery> query;
+        Bitset allowed;
+        int limit;
+        QSharedPointer<QAtomicInt> generation;
+        int job_generation;
+        QSharedPointer<QAtomicInt> total;
+        QFutureInterface<QVector<int> > results;
+
+        bool stale() const;
+        static QVector<int> scan(const Chunk &chunk);
+    };
+
+    bool replace; // the next rows replace the shown ones
+    int job_generation; // generation of the job that watcher follows
+    int next_result; // results before it were sent
+    int sent; // rows sent for the current job
+    PackageSnapshot store;
+    QSharedPointer<QAtomicInt> generation;
+    QSharedPointer<QAtomicInt> total; // matches of the current job, before the limit
+    QFutureWatcher<QVector<int> > *watcher; // a new one for each job, so no event of an old job arrives late
+};
+
+#endif // QUERYRUNNER_H
@@ -0,0 +1,129 @@
+/**********************************************************************
+ *  repoconfig.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "repoconfig.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QSettings>
+#include <QUrl>
+
+#include <QDebug>
+
+// Repos are listed in the "repos" key in the order they are shown, each one has its own section.
+// If the file is missing only the packages available through apt are shown
+QList<Repo> RepoConfig::load()
+{
+    QSettings config("/etc/mx-package-manager.conf", QSettings::IniFormat);
+    QStringList ids = config.value("repos", QStringList("stable")).toStringList();
+    QList<Repo> repos;
+    foreach (const QString &id, ids) {
+        config.beginGroup(id.trimmed());
+        Repo repo;
+        repo.id = id.trimmed();
+        repo.name = config.value("name", repo.id).toString();
+        repo.apt = (config.value("type", "apt").toString() == "apt");
+        repo.uri = config.value("uri").toString();
+        repo.source_uri = config.value("source_uri", repo.uri).toString();
+        repo.dist = detectDist(config.value("dist").toStringList());
+        repo.components = config.value("components").toStringList();
+        repo.release = config.value("release").toString();
+        repo.mirrors = config.value("mirrors").toStringList();
+        repo.warning = config.value("warning", false).toBool();
+        config.endGroup();
+        for (int i = 0; i < repo.components.size(); ++i) {
+            repo.components[i] = repo.components.at(i).trimmed();
+        }
+        if (!repo.apt && (repo.uri.isEmpty() || repo.dist.isEmpty() || repo.components.isEmpty())) {
+            qDebug() << "Incomplete repo in config file:" << repo.id;
+            continue;
+        }
+        if (!repo.uri.isEmpty() && !repo.uri.endsWith("/")) {
+            repo.uri += "/";
+        }
+        repos << repo;
+    }
+    if (repos.isEmpty()) {
+        Repo repo;
+        repo.id = "stable";
+        repo.name = QCoreApplication::translate("RepoConfig", "Stable Repo");
+        repo.apt = true;
+        repo.warning = false;
+        repos << repo;
+    }
+    return repos;
+}
+
+QStringList RepoConfig::aptHosts()
+{
+    QStringList hosts;
+    foreach (const QString &line, aptSources()) {
+        QStringList fields = line.split(" ");
+        int i = fields.at(1).startsWith("[") ? fields.indexOf(QRegExp(".*\\]")) + 1 : 1; // skip [options]
+        QString host = QUrl(fields.value(i)).host();
+        if (!host.isEmpty() && !hosts.contains(host)) {
+            hosts << host;
+        }
+    }
+    return hosts;
+}
+
+QStringList RepoConfig::aptSources()
+{
+    QStringList files = QDir("/etc/apt/sources.list.d").entryList(QStringList("*.list"));
+    for (int i = 0; i < files.size(); ++i) {
+        files[i] = "/etc/apt/sources.list.d/" + files.at(i);
+    }
+    files.prepend("/etc/apt/sources.list");
+
+    QStringList lines;
+    foreach (const QString &file_name, files) {
+        QFile file(file_name);
+        if (!file.open(QFile::ReadOnly | QFile::Text)) {
+            continue;
+        }
+        foreach (const QString &line, QString(file.readAll()).split("\n")) {
+            QString simplified = line.simplified();
+            if (simplified.startsWith("deb ")) {
+                lines << simplified;
+            }
+        }
+    }
+    return lines;
+}
+
+// Use the newest of the listed dists that apt already uses (e.g. mx16 on MX-16), the first one otherwise
+QString RepoConfig::detectDist(const QStringList &dists)
+{
+    QStringList sources = aptSources();
+    for (int i = dists.size() - 1; i > 0; --i) {
+        QRegExp re(".*\\s" + QRegExp::escape(dists.at(i).trimmed()) + "(\\s.*)?");
+        if (sources.indexOf(re) != -1) {
+            return dists.at(i).trimmed();
+        }
+    }
+    return dists.value(0).trimmed();
+}
@@ -0,0 +1,57 @@
+/**********************************************************************
+ *  repoconfig.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef REPOCONFIG_H
+#define REPOCONFIG_H
+
+#include <QList>
+#include <QStringList>
+
+// A source of packages shown in the Full App Catalog
+struct Repo {
+    QString id; // section in the config file
+    QString name;
+    bool apt; // packages come from the sources already configured for apt
+    QString uri; // where the index is downloaded from
+    QString source_uri; // used in the apt source line for installing
+    QString dist;
+    QStringList components;
+    QString release; // target release for apt-get, empty for the default one
+    QStringList mirrors; // candidates to pick the fastest from, uri is used if empty
+    bool warning; // show the Debian Backports warning when selected
+};
+
+// Reads the repos from /etc/mx-package-manager.conf
+class RepoConfig
+{
+public:
+    static QList<Repo> load();
+    static QStringList aptHosts(); // hosts of the http/https/ftp sources configured for apt
+
+private:
+    static QStringList aptSources(); // "deb" lines of the apt sources files
+    static QString detectDist(const QStringList &dists);
+};
+
+#endif // REPOCONFIG_H
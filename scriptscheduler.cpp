@@ -0,0 +1,238 @@
+/**********************************************************************
+ *  scriptscheduler.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "scriptscheduler.h"
+
+#include <QRegExp>
+
+#include <QDebug>
+
+ScriptScheduler::ScriptScheduler(QObject *parent) :
+    QObject(parent)
+{
+    max_workers = 4;
+    done_count = 0;
+    exclusive_running = false;
+}
+
+// Add a script; scripts that call apt/dpkg are always exclusive since they would compete for the dpkg lock
+void ScriptScheduler::addScript(const QString &name, const QString &script, const QStringList &after, bool exclusive)
+{
+    if (script.trimmed().isEmpty()) {
+        return;
+    }
+    Script item;
+    item.name = name;
+    item.script = script;
+    item.after = after;
+    item.exclusive = exclusive || script.contains(QRegExp("\\b(apt-get|apt|aptitude|dpkg)\\b"));
+    item.state = Waiting;
+    item.exit_code = 0;
+    item.time = 0;
+    scripts << item;
+}
+
+void ScriptScheduler::clear()
+{
+    scripts.clear();
+}
+
+bool ScriptScheduler::isEmpty()
+{
+    return scripts.isEmpty();
+}
+
+// Run all the scripts, starting each one as soon as its dependencies are done and a worker is free
+void ScriptScheduler::run(int max_workers)
+{
+    this->max_workers = qMax(1, max_workers);
+    done_count = 0;
+    exclusive_running = false;
+    if (scripts.isEmpty()) {
+        return;
+    }
+    startReady();
+    if (!processes.isEmpty()) {
+        loop.exec();
+    }
+
+    foreach (const Script &script, scripts) {
+        qDebug() << "script" << script.name << "exit code:" << script.exit_code << "time (ms):" << script.time;
+        if (script.exit_code != 0) {
+            qDebug() << "script output:" << script.output.trimmed();
+        }
+    }
+}
+
+// Exit code of the named script, -1 if it was not run
+int ScriptScheduler::getExitCode(const QString &name)
+{
+    int i = indexOf(name);
+    return (i == -1) ? -1 : scripts.at(i).exit_code;
+}
+
+// Output (stdout and stderr) of the named script
+QString ScriptScheduler::getOutput(const QString &name)
+{
+    int i = indexOf(name);
+    return (i == -1) ? QString() : scripts.at(i).output.trimmed();
+}
+
+// Run time of the named script in ms
+qint64 ScriptScheduler::getTime(const QString &name)
+{
+    int i = indexOf(name);
+    return (i == -1) ? 0 : scripts.at(i).time;
+}
+
+// A script that could not be started never emits finished, record it as failed and go on with the others
+void ScriptScheduler::onError(QProcess::ProcessError error)
+{
+    QProcess *proc = qobject_cast<QProcess *>(sender());
+    if (!proc || !processes.contains(proc) || error != QProcess::FailedToStart) {
+        return; // other errors are followed by finished
+    }
+    int i = processes.value(proc);
+    scripts[i].output += proc->errorString();
+    finish(proc, -1);
+}
+
+// Record the result of a finished script
+void ScriptScheduler::onFinished(int exit_code)
+{
+    QProcess *proc = qobject_cast<QProcess *>(sender());
+    if (!proc || !processes.contains(proc)) {
+        return;
+    }
+    scripts[processes.value(proc)].output += proc->readAll();
+    finish(proc, (proc->exitStatus() == QProcess::NormalExit) ? exit_code : -1);
+}
+
+// Collect the output of a running script
+void ScriptScheduler::onOutput()
+{
+    QProcess *proc = qobject_cast<QProcess *>(sender());
+    if (proc && processes.contains(proc)) {
+        scripts[processes.value(proc)].output += proc->readAll();
+    }
+}
+
+// Return true if all the scripts this one depends on are done
+bool ScriptScheduler::isReady(const Script &script)
+{
+    foreach (const QString &name, script.after) {
+        int i = indexOf(name);
+        if (i != -1 && scripts.at(i).state != Done) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ScriptScheduler::indexOf(const QString &name)
+{
+    for (int i = 0; i < scripts.size(); ++i) {
+        if (scripts.at(i).name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Mark the script of the process as done, report it and start the ones that were waiting for it
+void ScriptScheduler::finish(QProcess *proc, int exit_code)
+{
+    int i = processes.take(proc);
+    Script &script = scripts[i];
+    script.exit_code = exit_code;
+    script.time = script.timer.elapsed();
+    script.state = Done;
+    if (script.exclusive) {
+        exclusive_running = false;
+    }
+    proc->deleteLater();
+    emit scriptFinished(script.name, script.exit_code, script.time, script.output.trimmed());
+    emit progress(++done_count, scripts.size());
+
+    startReady();
+    if (processes.isEmpty()) {
+        loop.quit();
+    }
+}
+
+// Start the waiting scripts that are ready, within the worker limit
+void ScriptScheduler::startReady()
+{
+    for (int i = 0; i < scripts.size(); ++i) {
+        if (exclusive_running || processes.size() >= max_workers) {
+            break;
+        }
+        Script &script = scripts[i];
+        if (script.state != Waiting || !isReady(script)) {
+            continue;
+        }
+        if (script.exclusive) {
+            if (!processes.isEmpty()) {
+                break; // wait for the running scripts to finish, don't let later scripts jump ahead
+            }
+            exclusive_running = true;
+        }
+        QProcess *proc = new QProcess(this);
+        proc->setProcessChannelMode(QProcess::MergedChannels);
+        connect(proc, &QProcess::readyRead, this, &ScriptScheduler::onOutput);
+        connect(proc, static_cast<void (QProcess::*)(int)>(&QProcess::finished), this, &ScriptScheduler::onFinished);
+        connect(proc, static_cast<void (QProcess::*)(QProcess::ProcessError)>(&QProcess::error), this, &ScriptScheduler::onError);
+        processes.insert(proc, i);
+        script.state = Running;
+        script.timer.start();
+        qDebug() << "starting script:" << script.name;
+        proc->start("/bin/bash", QStringList() << "-c" << script.script);
+    }
+
+    // nothing running and nothing could start: the rest are waiting on a dependency cycle, report them as failed
+    if (processes.isEmpty()) {
+        QList<int> skipped;
+        for (int i = 0; i < scripts.size(); ++i) {
+            if (scripts.at(i).state == Waiting) {
+                skipped << i;
+            }
+        }
+        foreach (int i, skipped) {
+            Script &script = scripts[i];
+            QStringList waiting_on;
+            foreach (const QString &name, script.after) {
+                int j = indexOf(name);
+                if (j != -1 && skipped.contains(j)) {
+                    waiting_on << name;
+                }
+            }
+            qDebug() << "skipping script with unresolved dependencies:" << script.name;
+            script.state = Done;
+            script.exit_code = -1;
+            script.output = tr("unresolved dependency: %1").arg(waiting_on.join(", "));
+            emit scriptFinished(script.name, script.exit_code, script.time, script.output);
+            emit progress(++done_count, scripts.size());
+        }
+    }
+}
@@ -0,0 +1,88 @@
+/**********************************************************************
+ *  scriptscheduler.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef SCRIPTSCHEDULER_H
+#define SCRIPTSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHash>
+#include <QProcess>
+#include <QStringList>
+
+// Runs independent pre/postinstall scripts concurrently with a bounded number of workers
+class ScriptScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ScriptScheduler(QObject *parent = 0);
+
+    // after: names of scripts that need to finish first; exclusive: script can't run alongside other scripts
+    void addScript(const QString &name, const QString &script, const QStringList &after = QStringList(), bool exclusive = false);
+    void clear();
+    bool isEmpty();
+    void run(int max_workers = 4); // blocks until all the scripts are done
+
+    int getExitCode(const QString &name);
+    QString getOutput(const QString &name);
+    qint64 getTime(const QString &name); // run time in ms
+
+signals:
+    void progress(int done, int total);
+    void scriptFinished(const QString &name, int exit_code, qint64 time, const QString &output); // time in ms
+
+private slots:
+    void onError(QProcess::ProcessError error);
+    void onFinished(int exit_code);
+    void onOutput();
+
+private:
+    enum State { Waiting, Running, Done };
+    struct Script {
+        QString name;
+        QString script;
+        QStringList after;
+        bool exclusive;
+        State state;
+        int exit_code;
+        qint64 time;
+        QString output;
+        QElapsedTimer timer;
+    };
+
+    QList<Script> scripts;
+    QHash<QProcess *, int> processes; // running process -> index in scripts
+    QEventLoop loop;
+    int max_workers;
+    int done_count;
+    bool exclusive_running;
+
+    bool isReady(const Script &script);
+    int indexOf(const QString &name);
+    void finish(QProcess *proc, int exit_code);
+    void startReady();
+};
+
+#endif // SCRIPTSCHEDULER_H
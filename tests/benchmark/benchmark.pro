@@ -0,0 +1,46 @@
+# **********************************************************************
+# * Copyright (C) 2017 MX Authors
+# *
+# * Authors: Adrian
+# *          Dolphin_Oracle
+# *          MX Linux <http://mxlinux.org>
+# *
+# * This file is part of mx-package-manager.
+# *
+# * mx-package-manager is free software: you can redistribute it and/or modify
+# * it under the terms of the GNU General Public License as published by
+# * the Free Software Foundation, either version 3 of the License, or
+# * (at your option) any later version.
+# *
+# * mx-package-manager is distributed in the hope that it will be useful,
+# * but WITHOUT ANY WARRANTY; without even the implied warranty of
+# * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# * GNU General Public License for more details.
+# *
+# * You should have received a copy of the GNU General Public License
+# * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+# **********************************************************************/
+
+
+# Search benchmark over 60000 generated packages, not run by make check: ./search_benchmark
+
+QT       += core concurrent
+QT       -= gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TARGET = search_benchmark
+TEMPLATE = app
+
+INCLUDEPATH += ../..
+
+SOURCES += search_benchmark.cpp \
+    ../../bitset.cpp \
+    ../../nameindex.cpp \
+    ../../fuzzysearch.cpp
+
+HEADERS  += \
+    ../../bitset.h \
+    ../../nameindex.h \
+    ../../fuzzysearch.h
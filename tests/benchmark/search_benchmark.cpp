@@ -0,0 +1,128 @@
+/**********************************************************************
+ *  search_benchmark.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QStringList>
+#include <QTextStream>
+
+#include <bitset.h>
+#include <fuzzysearch.h>
+#include <nameindex.h>
+
+// Times the ranked search (FuzzySearch), the trigram name index (NameIndex) and a plain substring scan of the
+// names over 60000 generated packages, about the size of the Debian archive. The package names and descriptions
+// come from a fixed seed so runs can be compared
+
+const int package_count = 60000;
+const int runs = 20; // each query is timed over this many runs
+
+static quint32 seed = 1;
+
+// Small LCG, the same sequence on every platform
+static int nextRandom(int max)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) % max;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const char *syllables[] = {"lib", "py", "thon", "gtk", "qt", "kde", "x11", "dev", "doc", "font", "perl", "ruby", "net",
+                               "mx", "media", "audio", "video", "game", "3", "-", "-", "5", "core", "utils", "data"};
+    const char *words[] = {"library", "tools", "for", "the", "python", "interface", "bindings", "development", "files",
+                           "documentation", "game", "audio", "player", "video", "editor", "network", "server", "client",
+                           "plugin", "themes"};
+    QSet<QString> unique;
+    QStringList names;
+    QStringList descriptions;
+    while (names.size() < package_count) {
+        QString name;
+        for (int i = 2 + nextRandom(4); i > 0; --i) {
+            name += syllables[nextRandom(25)];
+        }
+        if (unique.contains(name)) {
+            continue;
+        }
+        unique.insert(name);
+        QStringList description;
+        for (int i = 3 + nextRandom(6); i > 0; --i) {
+            description << words[nextRandom(20)];
+        }
+        names << name;
+        descriptions << description.join(" ");
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    FuzzySearch fuzzy_search(names, descriptions);
+    NameIndex name_index(names);
+    out << "build: " << timer.elapsed() << " ms, " << (fuzzy_search.memoryUsage() + name_index.memoryUsage()) / 1024 << " KB\n";
+
+    Bitset all(names.size(), true);
+    QStringList queries;
+    queries << "p" << "py" << "gtk" << "python" << "pyqt" << "audio player" << "libgtkdev" << "mxdev" << "qtkde3";
+    foreach (const QString &query, queries) {
+        QVector<int> ranked;
+        int total = 0;
+        timer.start();
+        for (int i = 0; i < runs; ++i) {
+            ranked = fuzzy_search.find(query, all, 1000, &total);
+        }
+        double ranked_time = timer.nsecsElapsed() / 1e6 / runs;
+
+        Bitset found;
+        timer.start();
+        for (int i = 0; i < runs; ++i) {
+            found = name_index.find(query);
+        }
+        double index_time = timer.nsecsElapsed() / 1e6 / runs;
+
+        int scanned = 0;
+        timer.start();
+        for (int i = 0; i < runs; ++i) {
+            scanned = 0;
+            foreach (const QString &name, names) {
+                if (name.contains(query, Qt::CaseInsensitive)) {
+                    ++scanned;
+                }
+            }
+        }
+        double scan_time = timer.nsecsElapsed() / 1e6 / runs;
+
+        out << qSetFieldWidth(14) << left << query << qSetFieldWidth(0)
+            << " ranked " << QString::number(ranked_time, 'f', 2) << " ms (" << ranked.size() << " of " << total
+            << ", first: " << (ranked.isEmpty() ? QString("-") : names.at(ranked.first())) << ")"
+            << "  trigram " << QString::number(index_time, 'f', 2) << " ms (" << found.count() << ")"
+            << "  scan " << QString::number(scan_time, 'f', 2) << " ms (" << scanned << ")\n";
+    }
+
+    QVector<int> exact = fuzzy_search.find(names.at(123), all, 5);
+    out << "exact name ranked first: " << (!exact.isEmpty() && exact.first() == 123 ? "yes" : "no") << "\n";
+    return 0;
+}
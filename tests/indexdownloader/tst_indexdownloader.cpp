@@ -0,0 +1,265 @@
+/**********************************************************************
+ *  tst_indexdownloader.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <fetchscheduler.h>
+#include <indexcache.h>
+#include <indexdownloader.h>
+
+// Stand-in for a repo server: serves a Release file and one Packages file, can close the first
+// Packages transfer part way and switch to a new version of the file after it
+class RepoServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    struct Request {
+        QByteArray path;
+        QByteArray range;
+        QByteArray if_range;
+    };
+
+    explicit RepoServer(QObject *parent = 0);
+
+    QByteArray release;
+    QByteArray packages;
+    QByteArray etag;
+    qint64 cut_at; // the first Packages response is closed after this many bytes of data, -1 to send it whole
+    QByteArray next_packages; // served after the first Packages response if not empty
+    QByteArray next_etag;
+    QList<Request> requests; // Packages requests received
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    QHash<QTcpSocket *, QByteArray> buffers;
+
+    void respond(QTcpSocket *socket, const QByteArray &head);
+};
+
+RepoServer::RepoServer(QObject *parent) :
+    QTcpServer(parent),
+    cut_at(-1)
+{
+    connect(this, &QTcpServer::newConnection, this, &RepoServer::onNewConnection);
+}
+
+void RepoServer::onNewConnection()
+{
+    while (hasPendingConnections()) {
+        QTcpSocket *socket = nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, this, &RepoServer::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+    }
+}
+
+// Collect the request head, answer once it's complete
+void RepoServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    QByteArray &buffer = buffers[socket];
+    buffer += socket->readAll();
+    int end = buffer.indexOf("\r\n\r\n");
+    if (end == -1) {
+        return;
+    }
+    QByteArray head = buffer.left(end);
+    buffers.remove(socket);
+    respond(socket, head);
+}
+
+// Send the response and close the connection
+void RepoServer::respond(QTcpSocket *socket, const QByteArray &head)
+{
+    QList<QByteArray> lines = head.split('\n');
+    QByteArray path = lines.at(0).split(' ').value(1);
+    Request request;
+    request.path = path;
+    for (int i = 1; i < lines.size(); ++i) {
+        QByteArray line = lines.at(i).trimmed();
+        int colon = line.indexOf(':');
+        QByteArray field = line.left(colon).toLower();
+        QByteArray value = line.mid(colon + 1).trimmed();
+        if (field == "range") {
+            request.range = value;
+        } else if (field == "if-range") {
+            request.if_range = value;
+        }
+    }
+
+    QByteArray status = "200 OK";
+    QByteArray headers;
+    QByteArray body;
+    if (path.endsWith("/Release")) {
+        body = release;
+    } else if (path.endsWith("/Packages")) {
+        requests << request;
+        body = packages;
+        headers += "ETag: " + etag + "\r\n";
+        if (requests.size() == 1 && cut_at >= 0) {
+            headers += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+            socket->write("HTTP/1.1 " + status + "\r\n" + headers + "Connection: close\r\n\r\n" + body.left(cut_at));
+            socket->disconnectFromHost();
+            if (!next_packages.isEmpty()) {
+                packages = next_packages;
+                etag = next_etag;
+            }
+            return;
+        }
+        if (request.range.startsWith("bytes=") && (request.if_range.isEmpty() || request.if_range == etag)) {
+            qint64 start = request.range.mid(6, request.range.indexOf('-') - 6).toLongLong();
+            status = "206 Partial Content";
+            headers += "Content-Range: bytes " + QByteArray::number(start) + "-" + QByteArray::number(body.size() - 1) +
+                    "/" + QByteArray::number(body.size()) + "\r\n";
+            body = body.mid(start);
+        }
+    } else {
+        status = "404 Not Found";
+    }
+    headers += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    socket->write("HTTP/1.1 " + status + "\r\n" + headers + "Connection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+}
+
+
+class TestIndexDownloader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void resumesPartialTransfer();
+    void restartsWhenETagChanges();
+
+private:
+    QTemporaryDir *dir;
+    RepoServer *server;
+
+    QString distUrl();
+    QByteArray packagesFile(int count, const QString &version);
+    QByteArray releaseFile(const QByteArray &packages);
+};
+
+void TestIndexDownloader::init()
+{
+    dir = new QTemporaryDir();
+    server = new RepoServer();
+    QVERIFY(server->listen(QHostAddress::LocalHost));
+}
+
+void TestIndexDownloader::cleanup()
+{
+    delete server;
+    delete dir;
+}
+
+// The connection is closed half way, the retry asks for the rest with the ETag of the first half
+void TestIndexDownloader::resumesPartialTransfer()
+{
+    server->packages = packagesFile(300, "1.0");
+    server->etag = "\"v1\"";
+    server->cut_at = server->packages.size() / 2;
+    server->release = releaseFile(server->packages);
+
+    FetchScheduler scheduler;
+    IndexDownloader downloader(&scheduler);
+    downloader.setCacheDir(dir->path());
+    QVERIFY(downloader.download(distUrl(), QStringList("main/binary-amd64/Packages")));
+
+    QCOMPARE(server->requests.size(), 2);
+    QCOMPARE(server->requests.at(1).range, "bytes=" + QByteArray::number(server->cut_at) + "-");
+    QCOMPARE(server->requests.at(1).if_range, QByteArray("\"v1\""));
+
+    QFile file(IndexCache(dir->path()).fileName(QUrl(distUrl() + "/main/binary-amd64/Packages")));
+    QVERIFY(file.open(QFile::ReadOnly));
+    QVERIFY(file.readAll() == server->packages);
+    QMap<QString, QStringList> packages = downloader.packages();
+    QCOMPARE(packages.size(), 300);
+    QCOMPARE(packages.value("package299").value(0), QString("1.0"));
+}
+
+// The file changed on the server between the attempts, the partial data must be dropped
+void TestIndexDownloader::restartsWhenETagChanges()
+{
+    server->packages = packagesFile(300, "1.0");
+    server->etag = "\"v1\"";
+    server->cut_at = server->packages.size() / 2;
+    server->next_packages = packagesFile(320, "2.0");
+    server->next_etag = "\"v2\"";
+    server->release = releaseFile(server->next_packages);
+
+    FetchScheduler scheduler;
+    IndexDownloader downloader(&scheduler);
+    downloader.setCacheDir(dir->path());
+    QVERIFY(downloader.download(distUrl(), QStringList("main/binary-amd64/Packages")));
+
+    QCOMPARE(server->requests.size(), 2);
+    QCOMPARE(server->requests.at(1).if_range, QByteArray("\"v1\""));
+
+    QFile file(IndexCache(dir->path()).fileName(QUrl(distUrl() + "/main/binary-amd64/Packages")));
+    QVERIFY(file.open(QFile::ReadOnly));
+    QVERIFY(file.readAll() == server->next_packages);
+    QMap<QString, QStringList> packages = downloader.packages();
+    QCOMPARE(packages.size(), 320);
+    QCOMPARE(packages.value("package0").value(0), QString("2.0"));
+}
+
+QString TestIndexDownloader::distUrl()
+{
+    return "http://127.0.0.1:" + QString::number(server->serverPort()) + "/dists/test";
+}
+
+QByteArray TestIndexDownloader::packagesFile(int count, const QString &version)
+{
+    QByteArray data;
+    for (int i = 0; i < count; ++i) {
+        data += "Package: package" + QByteArray::number(i) + "\n"
+                "Version: " + version.toUtf8() + "\n"
+                "Section: utils\n"
+                "Installed-Size: 100\n"
+                "Description: test package number " + QByteArray::number(i) + "\n"
+                " with a long description line\n\n";
+    }
+    return data;
+}
+
+// Release file listing the uncompressed Packages file only
+QByteArray TestIndexDownloader::releaseFile(const QByteArray &packages)
+{
+    return "Suite: test\nSHA256:\n " + QCryptographicHash::hash(packages, QCryptographicHash::Sha256).toHex() + " " +
+            QByteArray::number(packages.size()) + " main/binary-amd64/Packages\n";
+}
+
+QTEST_GUILESS_MAIN(TestIndexDownloader)
+
+#include "tst_indexdownloader.moc"
@@ -0,0 +1,184 @@
+/**********************************************************************
+ *  tst_mirrorselector.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include <QHash>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QtTest>
+
+#include <mirrorselector.h>
+
+// Stand-in for a mirror: answers every request with 64 KB of data after a fixed latency
+class MirrorServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    explicit MirrorServer(int latency, QObject *parent = 0);
+
+    int latency; // ms
+    int requests;
+
+    QString url();
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void respondNext();
+
+private:
+    QHash<QTcpSocket *, QByteArray> buffers;
+    QList<QPointer<QTcpSocket> > waiting; // answered in order, they all wait the same time
+};
+
+MirrorServer::MirrorServer(int latency, QObject *parent) :
+    QTcpServer(parent),
+    latency(latency),
+    requests(0)
+{
+    connect(this, &QTcpServer::newConnection, this, &MirrorServer::onNewConnection);
+    listen(QHostAddress::LocalHost);
+}
+
+QString MirrorServer::url()
+{
+    return "http://127.0.0.1:" + QString::number(serverPort()) + "/debian/";
+}
+
+void MirrorServer::onNewConnection()
+{
+    while (hasPendingConnections()) {
+        QTcpSocket *socket = nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, this, &MirrorServer::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, socket, &QTcpSocket::deleteLater);
+    }
+}
+
+// Wait for the whole request head, then answer it after the latency
+void MirrorServer::onReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    QByteArray &buffer = buffers[socket];
+    buffer += socket->readAll();
+    if (!buffer.contains("\r\n\r\n")) {
+        return;
+    }
+    buffers.remove(socket);
+    ++requests;
+    waiting << socket;
+    QTimer *timer = new QTimer(this);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, &MirrorServer::respondNext);
+    timer->start(latency);
+}
+
+void MirrorServer::respondNext()
+{
+    sender()->deleteLater();
+    QPointer<QTcpSocket> socket = waiting.takeFirst();
+    if (!socket || socket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+    QByteArray body(64 * 1024, 'x');
+    socket->write("HTTP/1.1 206 Partial Content\r\n"
+                  "Content-Range: bytes 0-" + QByteArray::number(body.size() - 1) + "/1048576\r\n"
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Connection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+}
+
+
+class TestMirrorSelector : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void picksFastestMirror();
+    void reusesCachedChoice();
+
+private:
+    QTemporaryDir *dir;
+    QList<MirrorServer *> servers;
+
+    QStringList urls();
+};
+
+// Three mirrors, the second one is the fastest
+void TestMirrorSelector::init()
+{
+    dir = new QTemporaryDir();
+    servers << new MirrorServer(600) << new MirrorServer(0) << new MirrorServer(300);
+}
+
+void TestMirrorSelector::cleanup()
+{
+    qDeleteAll(servers);
+    servers.clear();
+    delete dir;
+}
+
+void TestMirrorSelector::picksFastestMirror()
+{
+    MirrorSelector selector("test", urls());
+    selector.setCacheFile(dir->path() + "/mirrors.conf");
+    QVERIFY(!selector.isCached());
+    QCOMPARE(selector.mirror("dists/test/Release"), servers.at(1)->url());
+    foreach (MirrorServer *server, servers) {
+        QCOMPARE(server->requests, 1);
+    }
+}
+
+// Within the ttl the choice is read from the cache file, even by another selector, and nothing is probed
+void TestMirrorSelector::reusesCachedChoice()
+{
+    MirrorSelector selector("test", urls());
+    selector.setCacheFile(dir->path() + "/mirrors.conf");
+    QCOMPARE(selector.mirror("dists/test/Release"), servers.at(1)->url());
+
+    servers.at(1)->latency = 900; // now the slowest one
+    MirrorSelector next("test", urls());
+    next.setCacheFile(dir->path() + "/mirrors.conf");
+    QVERIFY(next.isCached());
+    QCOMPARE(next.mirror("dists/test/Release"), servers.at(1)->url());
+    foreach (MirrorServer *server, servers) {
+        QCOMPARE(server->requests, 1);
+    }
+}
+
+QStringList TestMirrorSelector::urls()
+{
+    QStringList list;
+    foreach (MirrorServer *server, servers) {
+        list << server->url();
+    }
+    return list;
+}
+
+QTEST_GUILESS_MAIN(TestMirrorSelector)
+
+#include "tst_mirrorselector.moc"
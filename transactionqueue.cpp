@@ -0,0 +1,144 @@
+/**********************************************************************
+ *  transactionqueue.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "transactionqueue.h"
+
+TransactionQueue::TransactionQueue()
+{
+}
+
+// Add a Popular App to the queue
+void TransactionQueue::addApp(const QString &app)
+{
+    if (!app_list.contains(app)) {
+        app_list << app;
+    }
+}
+
+// Add packages to be installed, optionally from a specific release (e.g. jessie-backports) and extra sources
+void TransactionQueue::addInstall(const QStringList &names, const QString &release, const QStringList &sources)
+{
+    foreach (const QString &name, names) {
+        if (name.isEmpty()) {
+            continue;
+        }
+        operations.insert(name, "+");
+        if (release.isEmpty()) {
+            releases.remove(name);
+        } else {
+            releases.insert(name, release);
+        }
+        if (sources.isEmpty()) {
+            package_sources.remove(name);
+        } else {
+            package_sources.insert(name, sources);
+        }
+    }
+}
+
+// Add packages to be removed
+void TransactionQueue::addRemove(const QStringList &names)
+{
+    foreach (const QString &name, names) {
+        if (name.isEmpty()) {
+            continue;
+        }
+        operations.insert(name, "-");
+        releases.remove(name);
+        package_sources.remove(name);
+    }
+}
+
+// Remove all pending operations
+void TransactionQueue::clear()
+{
+    operations.clear();
+    releases.clear();
+    package_sources.clear();
+    app_list.clear();
+}
+
+bool TransactionQueue::isEmpty()
+{
+    return operations.isEmpty() && app_list.isEmpty();
+}
+
+// Return true if anything has to be downloaded, a queue of removals can be applied offline
+bool TransactionQueue::hasInstalls()
+{
+    return !app_list.isEmpty() || operations.values().contains("+");
+}
+
+// Number of queued packages and apps
+int TransactionQueue::count()
+{
+    return operations.size() + app_list.size();
+}
+
+// Return the package list in apt-get pkg+/pkg- syntax
+QString TransactionQueue::aptArgs()
+{
+    QStringList args;
+    QMap<QString, QString>::const_iterator i;
+    for (i = operations.constBegin(); i != operations.constEnd(); ++i) {
+        QString name = i.key();
+        if (releases.contains(name)) {
+            name += "/" + releases.value(name);
+        }
+        args << name + i.value();
+    }
+    return args.join(" ");
+}
+
+QStringList TransactionQueue::apps()
+{
+    return app_list;
+}
+
+// Return the packages to be installed from the sources that are already enabled
+QStringList TransactionQueue::defaultSourceInstalls()
+{
+    QStringList names;
+    QMap<QString, QString>::const_iterator i;
+    for (i = operations.constBegin(); i != operations.constEnd(); ++i) {
+        if (i.value() == "+" && !package_sources.contains(i.key())) {
+            names << i.key();
+        }
+    }
+    return names;
+}
+
+// Return the sources.list lines needed by the queued packages
+QStringList TransactionQueue::sources()
+{
+    QStringList source_list;
+    foreach (const QStringList &sources, package_sources) {
+        foreach (const QString &source, sources) {
+            if (!source_list.contains(source)) {
+                source_list << source;
+            }
+        }
+    }
+    return source_list;
+}
@@ -0,0 +1,59 @@
+/**********************************************************************
+ *  transactionqueue.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef TRANSACTIONQUEUE_H
+#define TRANSACTIONQUEUE_H
+
+#include <QMap>
+#include <QStringList>
+
+// Pending install/remove operations collected from all tabs, committed with one apt-get call
+class TransactionQueue
+{
+public:
+    TransactionQueue();
+
+    void addApp(const QString &app); // Popular App, pre/postinstall scripts run around the transaction
+    // sources: sources.list lines that need to be enabled to install the packages
+    void addInstall(const QStringList &names, const QString &release = QString(), const QStringList &sources = QStringList());
+    void addRemove(const QStringList &names);
+    void clear();
+
+    bool isEmpty();
+    bool hasInstalls(); // something to download: packages to install or apps
+    int count();
+    QString aptArgs(); // "pkg+ pkg/release+ pkg-" list for apt-get install
+    QStringList apps();
+    QStringList defaultSourceInstalls(); // packages to install that don't need extra sources
+    QStringList sources();
+
+private:
+    QMap<QString, QString> operations; // package name -> "+" or "-", last operation wins
+    QMap<QString, QString> releases;
+    QMap<QString, QStringList> package_sources;
+    QStringList app_list;
+
+};
+
+#endif // TRANSACTIONQUEUE_H
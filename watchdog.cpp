@@ -0,0 +1,103 @@
+/**********************************************************************
+ *  watchdog.cpp
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#include "watchdog.h"
+
+#include <QSettings>
+
+#include <QDebug>
+
+Watchdog::Watchdog(const QString &name, int deadline, int stall, QObject *parent) :
+    QObject(parent),
+    active(false),
+    expired_reason(None)
+{
+    QSettings config("/etc/mx-package-manager.conf", QSettings::IniFormat);
+    deadline = qMax(0, config.value("Network/" + name + "_deadline", deadline).toInt());
+    stall = qMax(0, config.value("Network/" + name + "_stall", stall).toInt());
+    setObjectName(name);
+    deadline_timer.setSingleShot(true);
+    deadline_timer.setInterval(deadline * 1000);
+    stall_timer.setSingleShot(true);
+    stall_timer.setInterval(stall * 1000);
+    connect(&deadline_timer, &QTimer::timeout, this, &Watchdog::onDeadline);
+    connect(&stall_timer, &QTimer::timeout, this, &Watchdog::onStall);
+}
+
+Watchdog::Reason Watchdog::reason() const
+{
+    return expired_reason;
+}
+
+QString Watchdog::message() const
+{
+    if (expired_reason == Deadline) {
+        return tr("The operation did not finish within %1 seconds.").arg(deadline_timer.interval() / 1000);
+    } else if (expired_reason == Stall) {
+        return tr("No data was received for %1 seconds.").arg(stall_timer.interval() / 1000);
+    }
+    return QString();
+}
+
+void Watchdog::start()
+{
+    active = true;
+    expired_reason = None;
+    if (deadline_timer.interval() > 0) {
+        deadline_timer.start();
+    }
+    kick();
+}
+
+void Watchdog::kick()
+{
+    if (active && stall_timer.interval() > 0) {
+        stall_timer.start();
+    }
+}
+
+void Watchdog::stop()
+{
+    active = false;
+    deadline_timer.stop();
+    stall_timer.stop();
+}
+
+void Watchdog::onDeadline()
+{
+    expire(Deadline);
+}
+
+void Watchdog::onStall()
+{
+    expire(Stall);
+}
+
+void Watchdog::expire(Reason reason)
+{
+    stop();
+    expired_reason = reason;
+    qDebug() << objectName() << "timed out:" << message();
+    emit expired();
+}
@@ -0,0 +1,67 @@
+/**********************************************************************
+ *  watchdog.h
+ **********************************************************************
+ * Copyright (C) 2017 MX Authors
+ *
+ * Authors: Adrian
+ *          MX Linux <http://mxlinux.org>
+ *
+ * This file is part of mx-package-manager.
+ *
+ * mx-package-manager is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mx-package-manager is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mx-package-manager.  If not, see <http://www.gnu.org/licenses/>.
+ **********************************************************************/
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <QObject>
+#include <QTimer>
+
+// Bounds a network operation by a deadline and by a stall timeout, the time allowed without any progress.
+// Limits are read from the [Network] section of /etc/mx-package-manager.conf as <name>_deadline and
+// <name>_stall, in seconds, 0 disables the limit. The owner calls kick() when data arrives and stops
+// the operation when expired() is emitted
+class Watchdog : public QObject
+{
+    Q_OBJECT
+public:
+    enum Reason { None, Deadline, Stall };
+
+    Watchdog(const QString &name, int deadline, int stall, QObject *parent = 0); // defaults in seconds
+
+    Reason reason() const; // why the last run expired, None if it didn't
+    QString message() const; // describes the exceeded limit for the user
+
+signals:
+    void expired();
+
+public slots:
+    void start();
+    void kick(); // progress was made, restart the stall timeout
+    void stop();
+
+private slots:
+    void onDeadline();
+    void onStall();
+
+private:
+    bool active;
+    Reason expired_reason;
+    QTimer deadline_timer;
+    QTimer stall_timer;
+
+    void expire(Reason reason);
+};
+
+#endif // WATCHDOG_H